@@ -0,0 +1,158 @@
+#include <Arduino.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <AllocTracker.h>
+
+struct AllocTrackerSite {
+    void *site;
+    uint32_t count;
+    uint32_t bytes;
+    uint32_t checked_count;
+};
+
+static AllocTrackerSite alloc_tracker_sites[ALLOC_TRACKER_MAX_SITES];
+static uint32_t alloc_tracker_count;
+static uint32_t alloc_tracker_bytes;
+static uint32_t alloc_tracker_checked_count;
+static bool alloc_tracker_checking = false;
+
+static uint32_t alloc_tracker_free_heap_low_water = UINT32_MAX;
+static uint32_t alloc_tracker_max_free_block_size_low_water = UINT32_MAX;
+
+void AllocTracker::record(void *site, size_t size) {
+    alloc_tracker_count++;
+    alloc_tracker_bytes += size;
+    if (alloc_tracker_checking) {
+        alloc_tracker_checked_count++;
+    }
+
+    for (size_t i = 0; i < ALLOC_TRACKER_MAX_SITES; i++) {
+        AllocTrackerSite &entry = alloc_tracker_sites[i];
+        if (!entry.site) {
+            entry.site = site;
+        }
+        if (entry.site == site) {
+            entry.count++;
+            entry.bytes += size;
+            if (alloc_tracker_checking) {
+                entry.checked_count++;
+            }
+            break;
+        }
+    }
+
+#ifdef ALLOC_TRACKER_STRICT
+    // the stack trace of the crash dump shows the allocation
+    if (alloc_tracker_checking) {
+        abort();
+    }
+#endif
+}
+
+void AllocTracker::setChecking(bool checking) {
+    alloc_tracker_checking = checking;
+}
+
+uint32_t AllocTracker::getCheckedAllocations() {
+    return alloc_tracker_checked_count;
+}
+
+void AllocTracker::sampleHeap(uint32_t free_heap, uint32_t max_free_block_size) {
+    if (free_heap < alloc_tracker_free_heap_low_water) {
+        alloc_tracker_free_heap_low_water = free_heap;
+    }
+    if (max_free_block_size < alloc_tracker_max_free_block_size_low_water) {
+        alloc_tracker_max_free_block_size_low_water = max_free_block_size;
+    }
+}
+
+uint32_t AllocTracker::getFreeHeapLowWater() {
+    return alloc_tracker_free_heap_low_water;
+}
+
+uint32_t AllocTracker::getMaxFreeBlockSizeLowWater() {
+    return alloc_tracker_max_free_block_size_low_water;
+}
+
+void AllocTracker::reset() {
+    memset(alloc_tracker_sites, 0, sizeof(alloc_tracker_sites));
+    alloc_tracker_count = 0;
+    alloc_tracker_bytes = 0;
+    alloc_tracker_checked_count = 0;
+}
+
+size_t AllocTracker::formatLine(size_t index, char *buffer, size_t size) {
+    if (index == 0) {
+        int len = snprintf_P(buffer, size, PSTR("total count=%lu bytes=%lu checked=%lu heap_low_water=%lu max_free_block_low_water=%lu\n"),
+            (unsigned long) alloc_tracker_count, (unsigned long) alloc_tracker_bytes, (unsigned long) alloc_tracker_checked_count,
+            (unsigned long) alloc_tracker_free_heap_low_water, (unsigned long) alloc_tracker_max_free_block_size_low_water);
+        return len > 0 ? len : 0;
+    }
+    index--;
+    if (index >= ALLOC_TRACKER_MAX_SITES || !alloc_tracker_sites[index].site) {
+        return 0;
+    }
+    // sites can be resolved with addr2line on the firmware ELF
+    const AllocTrackerSite &entry = alloc_tracker_sites[index];
+    int len = snprintf_P(buffer, size, PSTR("site %p count=%lu bytes=%lu checked=%lu\n"), entry.site, (unsigned long) entry.count, (unsigned long) entry.bytes,
+        (unsigned long) entry.checked_count);
+    return len > 0 ? len : 0;
+}
+
+#ifdef ALLOC_TRACKER
+
+// the linker redirects all calls to these functions (-Wl,--wrap=...), the original functions are available as __real_*
+// allocations made by the wrapped operator new are only recorded once, with the caller of operator new as site
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+}
+
+static uint8_t alloc_tracker_depth = 0;
+
+static void *alloc_tracker_track(void *site, size_t size, void *ptr) {
+    if (ptr && !alloc_tracker_depth) {
+        alloc_tracker_depth++;
+        AllocTracker::record(site, size);
+        alloc_tracker_depth--;
+    }
+    return ptr;
+}
+
+extern "C" {
+void *__wrap_malloc(size_t size) {
+    return alloc_tracker_track(__builtin_return_address(0), size, __real_malloc(size));
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    return alloc_tracker_track(__builtin_return_address(0), count * size, __real_calloc(count, size));
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    return alloc_tracker_track(__builtin_return_address(0), size, __real_realloc(ptr, size));
+}
+}
+
+// operator new(size_t), with the mangled name depending on the width of size_t
+#if __SIZEOF_SIZE_T__ == 4
+#define ALLOC_TRACKER_NEW __wrap__Znwj
+#define ALLOC_TRACKER_REAL_NEW __real__Znwj
+#else
+#define ALLOC_TRACKER_NEW __wrap__Znwm
+#define ALLOC_TRACKER_REAL_NEW __real__Znwm
+#endif
+
+extern "C" void *ALLOC_TRACKER_REAL_NEW(size_t size);
+
+extern "C" void *ALLOC_TRACKER_NEW(size_t size) {
+    void *site = __builtin_return_address(0);
+    alloc_tracker_depth++;
+    void *ptr = ALLOC_TRACKER_REAL_NEW(size);
+    alloc_tracker_depth--;
+    return alloc_tracker_track(site, size, ptr);
+}
+
+#endif
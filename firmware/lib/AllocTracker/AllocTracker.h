@@ -0,0 +1,46 @@
+#ifndef _ALLOC_TRACKER_H
+#define _ALLOC_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// maximum number of distinct call sites, further sites are only counted in total
+#define ALLOC_TRACKER_MAX_SITES 32
+
+// buffer size sufficient for a single formatted line
+#define ALLOC_TRACKER_LINE_SIZE 128
+
+// heap allocations per call site, and the low-water marks of the heap
+// allocations are only tracked if ALLOC_TRACKER is defined, and the allocation functions are wrapped by the linker
+// (see env:wificlock_alloc in platformio.ini), the heap low-water marks are always available
+class AllocTracker {
+public:
+    // records an allocation, called by the wrapped allocation functions
+    static void record(void *site, size_t size);
+
+    // while checking (set by ALLOC_TRACKER_CHECK), allocations are counted separately, and abort if ALLOC_TRACKER_STRICT is defined
+    static void setChecking(bool checking);
+
+    // returns the number of allocations while checking
+    static uint32_t getCheckedAllocations();
+
+    // records the current heap state for the low-water marks
+    static void sampleHeap(uint32_t free_heap, uint32_t max_free_block_size);
+
+    // returns the lowest free heap size and the lowest maximum free block size since start, or UINT32_MAX without samples
+    static uint32_t getFreeHeapLowWater();
+    static uint32_t getMaxFreeBlockSizeLowWater();
+
+    static void reset();
+
+    // formats a single line (summary first, then one per call site) into the buffer like snprintf, returns 0 after the last line
+    static size_t formatLine(size_t index, char *buffer, size_t size);
+};
+
+#ifdef ALLOC_TRACKER
+#define ALLOC_TRACKER_CHECK(checking) AllocTracker::setChecking(checking)
+#else
+#define ALLOC_TRACKER_CHECK(checking)
+#endif
+
+#endif
@@ -2,12 +2,22 @@
 #define _APP_H
 
 #include <inttypes.h>
+#include <limits.h>
+
+#include <Frame.h>
+#include <KeyEvents.h>
+
+// key numbers of the key events (bits of key column 0)
+#define APP_KEY_RIGHT 0
+#define APP_KEY_NEXT 1
+#define APP_KEY_LEFT 2
 
 class AppDisplayInterface {
 public:
     virtual void setBrightness(uint8_t brightness) = 0;
-    virtual void setChar(uint8_t digit, char ch, bool dot = false, bool case_fallback = false) = 0;
-    virtual void setColon(bool colon) = 0;
+
+    // sets the brightness until another app is entered, the one set by setBrightness is restored then
+    virtual void overrideBrightness(uint8_t brightness) = 0;
 
 protected:
     virtual ~AppDisplayInterface() = default; // prevent delete on pointers to this type
@@ -15,6 +25,9 @@ protected:
 
 class App {
 public:
+    App() : _frame { { 0, 0, 0, 0 }, 0, false }, _scheduled_frame { { 0, 0, 0, 0 }, 0, false }, _scheduled(false), _scheduled_micros(0) {
+    }
+
     virtual ~App() = default;
 
     virtual void init(AppDisplayInterface &display) {
@@ -29,7 +42,63 @@ public:
     virtual void handleKeyRight() {
     }
 
-    virtual void update(AppDisplayInterface &display) = 0;
+    // called for all key events except those of the next key, the default calls handleKeyLeft/handleKeyRight on presses
+    virtual void handleKeyEvent(const KeyEvent &event) {
+        if (event.type == KEY_EVENT_PRESS) {
+            if (event.key == APP_KEY_LEFT) {
+                handleKeyLeft();
+            } else if (event.key == APP_KEY_RIGHT) {
+                handleKeyRight();
+            }
+        }
+    }
+
+    // renders the app into its frame
+    // returns true iff the frame has changed since the last call
+    virtual bool update(AppDisplayInterface &display) = 0;
+
+    // returns the number of milliseconds until the frame may change without a key press, i.e. until update needs to be called again
+    virtual unsigned long getUpdateDelay() {
+        return 0;
+    }
+
+    // returns a short name of the app for diagnostics, the string must be valid until reset
+    virtual const char *getName() {
+        return "app";
+    }
+
+    // returns the frame rendered by the app
+    const Frame &getFrame() const {
+        return _frame;
+    }
+
+    // returns true iff the app has scheduled a frame to be shown at commit_micros (as returned by micros())
+    bool getScheduledFrame(const Frame *&frame, unsigned long &commit_micros) const {
+        frame = &_scheduled_frame;
+        commit_micros = _scheduled_micros;
+        return _scheduled;
+    }
+
+    // called when the scheduled frame has been shown, it becomes the frame of the app
+    void commitScheduledFrame() {
+        _frame = _scheduled_frame;
+        _scheduled = false;
+    }
+
+protected:
+    Frame _frame;
+
+    // schedules a frame to be shown as close as possible to the given time, replacing a previously scheduled frame
+    void scheduleFrame(const Frame &frame, unsigned long commit_micros) {
+        _scheduled_frame = frame;
+        _scheduled_micros = commit_micros;
+        _scheduled = true;
+    }
+
+private:
+    Frame _scheduled_frame;
+    bool _scheduled;
+    unsigned long _scheduled_micros;
 };
 
 #endif
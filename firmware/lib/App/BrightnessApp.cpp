@@ -1,6 +1,7 @@
 #include <BrightnessApp.h>
 
 BrightnessApp::BrightnessApp() :  _brightness(4), _changed(true) {
+    _render();
 }
 
 void BrightnessApp::init(AppDisplayInterface &display) {
@@ -13,20 +14,47 @@ void BrightnessApp::handleKeyLeft() {
     _changed = true;
 }
 
-void BrightnessApp::handleKeyRight() {;
+void BrightnessApp::handleKeyRight() {
     _brightness = _brightness < 4 ? _brightness + 1 : 4;
     _changed = true;
 }
 
-void BrightnessApp::update(AppDisplayInterface &display) {
-    if (_changed) {
-        display.setBrightness(_getDisplayBrightnessValue());
+void BrightnessApp::handleKeyEvent(const KeyEvent &event) {
+    // holding a key keeps changing the brightness
+    if (event.type == KEY_EVENT_PRESS || event.type == KEY_EVENT_REPEAT) {
+        if (event.key == APP_KEY_LEFT) {
+            handleKeyLeft();
+        } else if (event.key == APP_KEY_RIGHT) {
+            handleKeyRight();
+        }
     }
-    display.setChar(0, 'B', false, true);
-    display.setChar(1, 'R', false, true);
-    display.setChar(2, ' ');
-    display.setChar(3, '0' + _brightness);
-    display.setColon(true);
+}
+
+bool BrightnessApp::update(AppDisplayInterface &display) {
+    if (!_changed) {
+        return false;
+    }
+    display.setBrightness(_getDisplayBrightnessValue());
+    _render();
+    _changed = false;
+    return true;
+}
+
+unsigned long BrightnessApp::getUpdateDelay() {
+    // frame only changes on key presses
+    return _changed ? 0 : ULONG_MAX;
+}
+
+const char *BrightnessApp::getName() {
+    return "brightness";
+}
+
+void BrightnessApp::_render() {
+    _frame.setChar(0, 'B', false, true);
+    _frame.setChar(1, 'R', false, true);
+    _frame.setChar(2, ' ');
+    _frame.setChar(3, '0' + _brightness);
+    _frame.colon = true;
 }
 
 uint8_t BrightnessApp::_getDisplayBrightnessValue() {
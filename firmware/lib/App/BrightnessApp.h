@@ -11,13 +11,17 @@ public:
 
     virtual void handleKeyLeft() override;
     virtual void handleKeyRight() override;
-    virtual void update(AppDisplayInterface &display) override;
+    virtual void handleKeyEvent(const KeyEvent &event) override;
+    virtual bool update(AppDisplayInterface &display) override;
+    virtual unsigned long getUpdateDelay() override;
+    virtual const char *getName() override;
 
 private:
     uint8_t _brightness;
     bool _changed;
 
     uint8_t _getDisplayBrightnessValue();
+    void _render();
 };
 
 #endif
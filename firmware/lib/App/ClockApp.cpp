@@ -1,14 +1,30 @@
-#include <stdio.h>
+#include <Arduino.h>
+
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <sys/time.h>
 
+#include <BootTimeline.h>
 #include <ClockApp.h>
 
-ClockApp::ClockApp() : _mode(_CLOCK_APP_MODE_TIME_NOT_SET), _time_trailing_dot(false), _time_blinking_colon(true) {
+ClockApp::ClockApp(TimeDiscipline &time_discipline)
+    : _time_discipline(time_discipline), _mode(_CLOCK_APP_MODE_TIME_NOT_SET), _time_trailing_dot(false), _time_blinking_colon(true),
+      _current_chars { "    ", false, 0, 0 }, _next_chars { "    ", false, 0, 0 } {
+}
+
+static void formatTwoDigits(char *dst, int value, char leading) {
+    dst[0] = value >= 10 ? '0' + value / 10 : leading;
+    dst[1] = '0' + value % 10;
 }
 
 void ClockApp::notifyTimeSet() {
+    if (_mode == _CLOCK_APP_MODE_TIME_NOT_SET) {
+        BootTimeline::mark(PSTR("clock time set"));
+    }
     _mode = _CLOCK_APP_MODE_TIME;
+    // time may have been stepped
+    _invalidateChars();
 }
 
 void ClockApp::setTimeTrailingDot(bool time_trailing_dot) {
@@ -41,39 +57,108 @@ void ClockApp::handleKeyRight() {
         _mode = _CLOCK_APP_MODE_TIME;
         break;
     }
+    _invalidateChars();
 }
 
-void ClockApp::update(AppDisplayInterface &display) {
-    timeval now;
-    gettimeofday(&now, nullptr);
+bool ClockApp::update(AppDisplayInterface &display) {
+    int64_t mono_micros = micros64();
+    int64_t time_micros = _time_discipline.getTime(mono_micros);
 
-    tm local;
-    localtime_r(&now.tv_sec, &local);
+    // the colon blinks and the digits change at half-second boundaries at most
+    // the frame for the next boundary is scheduled, so that it is shown exactly at that boundary
+    int64_t next_micros = (time_micros / 500000 + 1) * 500000;
+    Frame next;
+    _renderFrame(next_micros, _next_chars, next);
+    scheduleFrame(next, (unsigned long) _time_discipline.getMonoTime(next_micros, mono_micros));
+
+    Frame frame;
+    _renderFrame(time_micros, _current_chars, frame);
+    if (frame == _frame) {
+        return false;
+    }
+    _frame = frame;
+    return true;
+}
+
+unsigned long ClockApp::getUpdateDelay() {
+    // the next frame is scheduled, so an update is only needed after the boundary to schedule the one after it
+    int64_t time_micros = _time_discipline.getTime(micros64());
+    return (500000 - time_micros % 500000 + 999) / 1000;
+}
+
+const char *ClockApp::getName() {
+    return "clock";
+}
+
+void ClockApp::_invalidateChars() {
+    _current_chars.valid = false;
+    _next_chars.valid = false;
+}
+
+void ClockApp::_renderFrame(int64_t time_micros, _Chars &chars, Frame &frame) {
+    time_t time = time_micros / 1000000;
+    bool first_half = time_micros % 1000000 < 500000;
+
+    // the digits only change when the displayed unit rolls over, the time is stepped back, or the mode changes
+    if (!chars.valid || time < chars.time || time >= chars.valid_until) {
+        _renderChars(time, chars);
+    }
 
-    char chars[5] = "    ";
-    bool dots[4] = { false, false, false, false };
-    bool colon = false;
+    frame.dots = 0;
+    frame.colon = false;
 
     switch (_mode) {
     case _CLOCK_APP_MODE_TIME:
-        snprintf_P(chars, sizeof(chars), PSTR("%2d%02d"), local.tm_hour, local.tm_min);
     case _CLOCK_APP_MODE_TIME_NOT_SET:
-        colon = !_time_blinking_colon || now.tv_usec < 500000;
-        dots[3] = _time_trailing_dot;
+        frame.colon = !_time_blinking_colon || first_half;
+        frame.setDot(3, _time_trailing_dot);
         break;
     case _CLOCK_APP_MODE_DATE:
-        snprintf_P(chars, sizeof(chars), PSTR("%02d%02d"), local.tm_mday, local.tm_mon + 1);
-        dots[1] = true;
-        dots[3] = true;
+        frame.setDot(1, true);
+        frame.setDot(3, true);
         break;
     case _CLOCK_APP_MODE_SECONDS:
-        snprintf_P(chars, sizeof(chars), PSTR("  %02d"), local.tm_sec);
-        colon = now.tv_usec < 500000;
+        frame.colon = first_half;
         break;
     }
 
     for (uint8_t i = 0; i < 4; i++) {
-        display.setChar(i, chars[i], dots[i]);
+        frame.glyphs[i] = SevenSegment.getBits(chars.chars[i]);
     }
-    display.setColon(colon);
+}
+
+void ClockApp::_renderChars(time_t time, _Chars &chars) {
+    tm local;
+    if (_mode != _CLOCK_APP_MODE_TIME_NOT_SET) {
+        // only parsed again if the variable has changed
+        _time_zone.set(getenv("TZ"));
+        _time_zone.toLocal(time, local);
+    }
+
+    memcpy(chars.chars, "    ", 4);
+
+    switch (_mode) {
+    case _CLOCK_APP_MODE_TIME_NOT_SET:
+        // nothing to show until the time is set
+        chars.valid_until = time + 60;
+        break;
+    case _CLOCK_APP_MODE_TIME:
+        formatTwoDigits(&chars.chars[0], local.tm_hour, ' ');
+        formatTwoDigits(&chars.chars[2], local.tm_min, '0');
+        // DST transitions and UTC offsets are whole minutes, so the digits are valid until the next minute
+        chars.valid_until = time - local.tm_sec + 60;
+        break;
+    case _CLOCK_APP_MODE_DATE:
+        formatTwoDigits(&chars.chars[0], local.tm_mday, '0');
+        formatTwoDigits(&chars.chars[2], local.tm_mon + 1, '0');
+        chars.valid_until = time - local.tm_sec + 60;
+        break;
+    case _CLOCK_APP_MODE_SECONDS:
+        formatTwoDigits(&chars.chars[2], local.tm_sec, '0');
+        chars.valid_until = time + 1;
+        break;
+    }
+
+    chars.time = time;
+    chars.valid = true;
 }
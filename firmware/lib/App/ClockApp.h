@@ -1,20 +1,28 @@
 #ifndef _CLOCK_APP_H
 #define _CLOCK_APP_H
 
+#include <time.h>
+
 #include <App.h>
+#include <TimeDiscipline.h>
+#include <TimeZone.h>
 
 class ClockApp : public App {
 public:
-    ClockApp();
+    ClockApp(TimeDiscipline &time_discipline);
 
     void notifyTimeSet();
     void setTimeTrailingDot(bool time_trailing_dot);
 
     virtual void handleKeyLeft() override;
     virtual void handleKeyRight() override;
-    virtual void update(AppDisplayInterface &display) override;
+    virtual bool update(AppDisplayInterface &display) override;
+    virtual unsigned long getUpdateDelay() override;
+    virtual const char *getName() override;
 
 private:
+    TimeDiscipline &_time_discipline;
+
     enum {
         _CLOCK_APP_MODE_TIME_NOT_SET,
         _CLOCK_APP_MODE_TIME,
@@ -23,6 +31,25 @@ private:
     } _mode;
     bool _time_trailing_dot;
     bool _time_blinking_colon;
+
+    // rendered digits, valid from time until before valid_until
+    struct _Chars {
+        char chars[5];
+        bool valid;
+        time_t time;
+        time_t valid_until;
+    };
+
+    // one for the current frame and one for the scheduled frame, so that they don't evict each other near a rollover
+    _Chars _current_chars;
+    _Chars _next_chars;
+
+    // follows the TZ environment variable (set by configTime)
+    TimeZone _time_zone;
+
+    void _invalidateChars();
+    void _renderFrame(int64_t time_micros, _Chars &chars, Frame &frame);
+    void _renderChars(time_t time, _Chars &chars);
 };
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef _FRAME_H
+#define _FRAME_H
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <SevenSegment.h>
+
+// contents of the display: segment bits of the four digits, their dots, and the colon
+struct Frame {
+    uint8_t glyphs[4];
+    // bit i is the dot of digit i
+    uint8_t dots;
+    bool colon;
+
+    void clear() {
+        memset(glyphs, 0, sizeof(glyphs));
+        dots = 0;
+        colon = false;
+    }
+
+    void setChar(uint8_t digit, char ch, bool dot = false, bool case_fallback = false) {
+        glyphs[digit] = SevenSegment.getBits(ch, case_fallback);
+        setDot(digit, dot);
+    }
+
+    void setDot(uint8_t digit, bool dot) {
+        dots = dot ? dots | (1 << digit) : dots & ~(1 << digit);
+    }
+
+    bool operator==(const Frame &other) const {
+        return !memcmp(glyphs, other.glyphs, sizeof(glyphs)) && dots == other.dots && colon == other.colon;
+    }
+
+    bool operator!=(const Frame &other) const {
+        return !(*this == other);
+    }
+};
+
+#endif
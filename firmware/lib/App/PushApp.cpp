@@ -0,0 +1,144 @@
+#include <Arduino.h>
+
+#include <algorithm>
+
+#include <PushApp.h>
+
+// packets are polled, so this is the added latency while the app is shown
+#define PUSH_APP_POLL_INTERVAL_MILLIS 5
+
+// maximum number of packets handled per call to receive, to bound the time spent
+#define PUSH_APP_MAX_PACKETS_PER_RECEIVE 8
+
+PushApp::PushApp(PushPacketSource &source)
+    : _source(source), _changed(true), _brightness(0xff), _brightness_changed(false), _sequence_valid(false), _sequence(0), _hold_millis(0), _frame_millis(0),
+      _ack_pending(false), _ack_sequence(0), _stats { 0, 0, 0, 0 } {
+    _clearFrame();
+}
+
+void PushApp::enter() {
+    _changed = true;
+    // the override has been dropped when the app was left
+    _brightness_changed = _brightness != 0xff;
+}
+
+void PushApp::receive() {
+    // acknowledge after the frame has been returned by update, i.e. after the display has been updated
+    if (_ack_pending && !_changed) {
+        uint8_t ack[PUSH_APP_ACK_SIZE] = { PUSH_APP_MAGIC, 'A', (uint8_t) _ack_sequence, (uint8_t) (_ack_sequence >> 8), (uint8_t) (_ack_sequence >> 16),
+            (uint8_t) (_ack_sequence >> 24) };
+        _source.reply(ack, sizeof(ack));
+        _ack_pending = false;
+    }
+
+    uint8_t packet[PUSH_APP_PACKET_SIZE];
+    for (uint8_t i = 0; i < PUSH_APP_MAX_PACKETS_PER_RECEIVE; i++) {
+        size_t len = _source.receive(packet, sizeof(packet));
+        if (!len) {
+            break;
+        }
+        handlePacket(packet, len);
+    }
+}
+
+static uint32_t readUint32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+bool PushApp::handlePacket(const uint8_t *data, size_t len) {
+    _stats.received++;
+
+    if (len != PUSH_APP_PACKET_SIZE || data[0] != PUSH_APP_MAGIC || data[1] != PUSH_APP_VERSION) {
+        _stats.malformed++;
+        return false;
+    }
+
+    uint32_t sequence = readUint32(data + 2);
+    uint8_t flags = data[11];
+
+    // serial number arithmetic, so that the sequence number may wrap
+    if (_sequence_valid && !(flags & PUSH_APP_FLAG_RESET) && (int32_t) (sequence - _sequence) <= 0) {
+        _stats.stale++;
+        return false;
+    }
+    _sequence_valid = true;
+    _sequence = sequence;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        if (flags & PUSH_APP_FLAG_CHARS) {
+            _next_frame.setChar(i, data[6 + i], false, true);
+        } else {
+            _next_frame.glyphs[i] = data[6 + i];
+        }
+    }
+    _next_frame.dots = data[10] & 0x0f;
+    _next_frame.colon = flags & PUSH_APP_FLAG_COLON;
+
+    if (flags & PUSH_APP_FLAG_BRIGHTNESS) {
+        _brightness = data[12] & 0x0f;
+        _brightness_changed = true;
+    }
+
+    _hold_millis = data[13] | (data[14] << 8);
+    _frame_millis = millis();
+    _changed = true;
+
+    // later packets without the flag don't cancel the acknowledgement
+    if (flags & PUSH_APP_FLAG_ACK) {
+        _source.keepSender();
+        _ack_pending = true;
+        _ack_sequence = sequence;
+    }
+
+    _stats.accepted++;
+    return true;
+}
+
+bool PushApp::update(AppDisplayInterface &display) {
+    // only applies frames that have already been received, the network is serviced by receive
+    if (_hold_millis && millis() - _frame_millis >= _hold_millis) {
+        _clearFrame();
+        _hold_millis = 0;
+        _changed = true;
+    }
+
+    if (_brightness_changed) {
+        display.overrideBrightness(_brightness);
+        _brightness_changed = false;
+    }
+
+    if (!_changed) {
+        return false;
+    }
+    _frame = _next_frame;
+    _changed = false;
+    return true;
+}
+
+unsigned long PushApp::getUpdateDelay() {
+    if (_changed || _ack_pending) {
+        return 0;
+    }
+    unsigned long delay_millis = PUSH_APP_POLL_INTERVAL_MILLIS;
+    if (_hold_millis) {
+        unsigned long elapsed_millis = millis() - _frame_millis;
+        delay_millis = std::min(delay_millis, elapsed_millis >= _hold_millis ? 0 : _hold_millis - elapsed_millis);
+    }
+    return delay_millis;
+}
+
+const char *PushApp::getName() {
+    return "push";
+}
+
+const PushAppStats &PushApp::getStats() {
+    return _stats;
+}
+
+void PushApp::_clearFrame() {
+    // dashes until the first frame has been received, and after the hold time
+    for (uint8_t i = 0; i < 4; i++) {
+        _next_frame.setChar(i, '-');
+    }
+    _next_frame.colon = false;
+}
@@ -0,0 +1,77 @@
+#ifndef _PUSH_APP_H
+#define _PUSH_APP_H
+
+#include <App.h>
+#include <PushPacketSource.h>
+
+// frame packet, all values little endian:
+//  0     magic 'W'
+//  1     version 1
+//  2- 5  sequence number, packets that are not newer than the last accepted one are dropped
+//  6- 9  glyphs, segment bits (or characters, with PUSH_APP_FLAG_CHARS)
+// 10     dots, bit i is the dot of digit i
+// 11     flags (PUSH_APP_FLAG_*)
+// 12     brightness 0-15 (with PUSH_APP_FLAG_BRIGHTNESS), while the app is shown
+// 13-14  hold time in milliseconds after which the frame is cleared, 0 to show it until the next one
+#define PUSH_APP_PACKET_SIZE 15
+#define PUSH_APP_MAGIC 'W'
+#define PUSH_APP_VERSION 1
+
+#define PUSH_APP_FLAG_COLON 0x01
+#define PUSH_APP_FLAG_BRIGHTNESS 0x02
+#define PUSH_APP_FLAG_CHARS 0x04
+// accept the packet regardless of its sequence number (e.g. after the sender has restarted)
+#define PUSH_APP_FLAG_RESET 0x08
+// reply with an acknowledgement ('W', 'A', sequence number) to the sender after the frame has been pushed to the display
+// (or a newer frame, if it has been replaced in the meantime), only the acknowledgement requested last is sent
+#define PUSH_APP_FLAG_ACK 0x10
+
+#define PUSH_APP_ACK_SIZE 6
+
+struct PushAppStats {
+    uint32_t received;
+    uint32_t accepted;
+    uint32_t stale;
+    uint32_t malformed;
+};
+
+// shows frames received as compact binary packets (e.g. over UDP), without heap allocations
+class PushApp : public App {
+public:
+    PushApp(PushPacketSource &source);
+
+    virtual void enter() override;
+
+    // sends a pending acknowledgement, and receives and handles all pending packets
+    // must be called regularly (not only while the app is shown), so that packets don't queue up
+    // update doesn't do any network I/O, because sending and receiving allocates buffers (see lib/AllocTracker)
+    void receive();
+
+    // handles a single packet, returns true iff it has been accepted
+    bool handlePacket(const uint8_t *data, size_t len);
+
+    virtual bool update(AppDisplayInterface &display) override;
+    virtual unsigned long getUpdateDelay() override;
+    virtual const char *getName() override;
+
+    const PushAppStats &getStats();
+
+private:
+    PushPacketSource &_source;
+    Frame _next_frame;
+    bool _changed;
+    // brightness of the last packet with PUSH_APP_FLAG_BRIGHTNESS (0xff if none), it overrides the display brightness while the app is shown
+    uint8_t _brightness;
+    bool _brightness_changed;
+    bool _sequence_valid;
+    uint32_t _sequence;
+    unsigned long _hold_millis;
+    unsigned long _frame_millis;
+    bool _ack_pending;
+    uint32_t _ack_sequence;
+    PushAppStats _stats;
+
+    void _clearFrame();
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef _PUSH_PACKET_SOURCE_H
+#define _PUSH_PACKET_SOURCE_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+class PushPacketSource {
+public:
+    // receives the next pending packet into data (truncated to size)
+    // returns the length of the packet, or 0 if no packet is pending
+    virtual size_t receive(uint8_t *data, size_t size) = 0;
+
+    // keeps the sender of the last received packet as the target of reply, until it is called again
+    // (the sender is not kept by receive, because later packets may be stale or malformed)
+    virtual void keepSender() = 0;
+
+    // sends data to the kept sender, does nothing if no sender has been kept
+    virtual void reply(const uint8_t *data, size_t size) = 0;
+
+protected:
+    virtual ~PushPacketSource() = default; // prevent delete on pointers to this type
+};
+
+#endif
@@ -1,49 +1,205 @@
 #include <Arduino.h>
 
-#include <string>
+#include <vector>
 
 #include <ScrollerApp.h>
+#include <SevenSegment.h>
 
-ScrollerApp::ScrollerApp(const std::string &text, unsigned long autoscroll_delay_millis) : _text(text), _autoscroll_delay_millis(autoscroll_delay_millis) {
+unsigned long scrollerConstantTiming(size_t step, size_t steps, unsigned long delay_millis) {
+    return delay_millis;
+}
+
+unsigned long scrollerPauseAtStartTiming(size_t step, size_t steps, unsigned long delay_millis) {
+    return step ? delay_millis : 4 * delay_millis;
+}
+
+unsigned long scrollerEaseTiming(size_t step, size_t steps, unsigned long delay_millis) {
+    // distance from the start of the text in both directions (it wraps around), 0 to steps / 2
+    size_t distance = step < steps - step ? step : steps - step;
+    // twice the delay at the start, down to half the delay from 8 steps away
+    return distance >= 8 ? delay_millis / 2 : delay_millis * (32 - 3 * distance) / 16;
+}
+
+ScrollerApp::ScrollerApp(const char *text, unsigned long autoscroll_delay_millis, ScrollerTimingCurve timing)
+    : _glyphs(), _text_P(nullptr), _steps(0), _position(0), _cursor(0), _last_cursor(0), _changed(true), _autoscroll(false), _autoscroll_delay_millis(autoscroll_delay_millis), _last_autoscroll_millis(0), _timing(timing) {
+    setText(text);
+}
+
+void ScrollerApp::setText(const char *text) {
+    _glyphs.clear();
+    _text_P = nullptr;
+
+    // a dot is folded into the preceding digit, unless that already has one (so "12.5" takes three digits)
+    bool dot_allowed = false;
+    for (const char *p = text; *p; p++) {
+        if (*p == '.' && dot_allowed) {
+            _glyphs.back() |= 0x80;
+            dot_allowed = false;
+        } else {
+            _glyphs.push_back(*p == '.' ? 0x80 : SevenSegment.getBits(*p, true));
+            dot_allowed = *p != '.';
+        }
+    }
+
+    // repeat the start of the text, even multiple times for texts shorter than the display
+    _steps = _glyphs.size();
+    if (_steps) {
+        for (size_t i = 0; i < 3; i++) {
+            _glyphs.push_back(_glyphs[i]);
+        }
+    }
+    _glyphs.shrink_to_fit();
+
+    _reset();
+}
+
+void ScrollerApp::setText_P(PGM_P text) {
+    _glyphs.clear();
+    _glyphs.shrink_to_fit();
+    _text_P = text;
+
+    // only count the digits, they are decoded again when they are shown
+    _steps = 0;
+    uint8_t glyph;
+    for (size_t offset = 0; pgm_read_byte(text + offset); offset += _readDigit_P(offset, glyph)) {
+        _last_cursor = offset;
+        _steps++;
+    }
+
+    _reset();
 }
 
 void ScrollerApp::enter() {
-    _position = _text.c_str();
+    _reset();
     _last_autoscroll_millis = millis();
     _autoscroll = _autoscroll_delay_millis > 0;
 }
 
 void ScrollerApp::handleKeyLeft() {
     _autoscroll = false;
-    if (--_position < _text.c_str()) {
-        _position += _text.length();
+    if (_steps) {
+        _step(false);
     }
 }
 
 void ScrollerApp::handleKeyRight() {
     _autoscroll = false;
-    if (!*++_position) {
-        _position = _text.c_str();
+    if (_steps) {
+        _step(true);
     }
 }
 
-void ScrollerApp::update(AppDisplayInterface &display) {
-    if (*_position) {
-        if (_autoscroll) {
-            unsigned long cur_millis = millis();
-            if (cur_millis - _last_autoscroll_millis > _autoscroll_delay_millis) {
-                if (!*++_position) {
-                    _position = _text.c_str();
-                }
-                _last_autoscroll_millis = cur_millis;
-            }
+void ScrollerApp::handleKeyEvent(const KeyEvent &event) {
+    // holding a key keeps scrolling
+    if (event.type == KEY_EVENT_PRESS || event.type == KEY_EVENT_REPEAT) {
+        if (event.key == APP_KEY_LEFT) {
+            handleKeyLeft();
+        } else if (event.key == APP_KEY_RIGHT) {
+            handleKeyRight();
+        }
+    }
+}
+
+bool ScrollerApp::update(AppDisplayInterface &display) {
+    if (!_steps) {
+        return false;
+    }
+    if (_autoscroll) {
+        unsigned long cur_millis = millis();
+        if (cur_millis - _last_autoscroll_millis > _getStepDelay()) {
+            _step(true);
+            _last_autoscroll_millis = cur_millis;
         }
-        const char *p = _position;
+    }
+    if (!_changed) {
+        return false;
+    }
+    uint8_t window[4];
+    if (_text_P) {
+        size_t offset = _cursor;
+        size_t position = _position;
         for (uint8_t i = 0; i < 4; i++) {
-            display.setChar(i, *p, false, true);
-            if (!*++p) {
-                p = _text.c_str();
+            offset += _readDigit_P(offset, window[i]);
+            if (++position == _steps) {
+                position = 0;
+                offset = 0;
             }
         }
+    } else {
+        memcpy(window, &_glyphs[_position], sizeof(window));
+    }
+    _frame.dots = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        _frame.glyphs[i] = window[i] & 0x7f;
+        _frame.dots |= (window[i] >> 7) << i;
+    }
+    _changed = false;
+    return true;
+}
+
+unsigned long ScrollerApp::getUpdateDelay() {
+    if (!_steps) {
+        // nothing to show
+        return ULONG_MAX;
     }
+    if (_changed) {
+        return 0;
+    }
+    if (!_autoscroll) {
+        // frame only changes on key presses
+        return ULONG_MAX;
+    }
+    unsigned long delay_millis = _getStepDelay();
+    unsigned long elapsed_millis = millis() - _last_autoscroll_millis;
+    return elapsed_millis > delay_millis ? 0 : delay_millis - elapsed_millis + 1;
+}
+
+const char *ScrollerApp::getName() {
+    return "scroller";
+}
+
+void ScrollerApp::_reset() {
+    _position = 0;
+    _cursor = 0;
+    _changed = true;
+}
+
+void ScrollerApp::_step(bool forward) {
+    uint8_t glyph;
+    if (forward) {
+        if (++_position == _steps) {
+            _position = 0;
+        }
+        if (_text_P) {
+            _cursor = _position ? _cursor + _readDigit_P(_cursor, glyph) : 0;
+        }
+    } else {
+        _position = (_position ? _position : _steps) - 1;
+        if (_text_P) {
+            // a non-dot character always starts a digit, and takes a dot that follows it
+            bool folded_dot = _cursor >= 2 && pgm_read_byte(_text_P + _cursor - 1) == '.' && pgm_read_byte(_text_P + _cursor - 2) != '.';
+            _cursor = _position == _steps - 1 ? _last_cursor : _cursor - (folded_dot ? 2 : 1);
+        }
+    }
+    _changed = true;
+}
+
+// decodes the digit of the flash text at the given offset, returns the number of characters it takes
+size_t ScrollerApp::_readDigit_P(size_t offset, uint8_t &glyph) {
+    char ch = pgm_read_byte(_text_P + offset);
+    if (ch == '.') {
+        // a dot that cannot be folded, because the preceding digit is a dot itself or already has one
+        glyph = 0x80;
+        return 1;
+    }
+    glyph = SevenSegment.getBits(ch, true);
+    if (pgm_read_byte(_text_P + offset + 1) == '.') {
+        glyph |= 0x80;
+        return 2;
+    }
+    return 1;
+}
+
+unsigned long ScrollerApp::_getStepDelay() {
+    return _timing(_position, _steps, _autoscroll_delay_millis);
 }
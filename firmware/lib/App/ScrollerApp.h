@@ -1,26 +1,63 @@
 #ifndef _SCROLLER_APP_H
 #define _SCROLLER_APP_H
 
-#include <string>
+#include <Arduino.h>
+
+#include <vector>
 
 #include <App.h>
 
+// returns the number of milliseconds to show the window at the given step (0 to steps - 1) before autoscrolling to the next one
+typedef unsigned long (*ScrollerTimingCurve)(size_t step, size_t steps, unsigned long delay_millis);
+
+// shows every step for the same time
+unsigned long scrollerConstantTiming(size_t step, size_t steps, unsigned long delay_millis);
+
+// holds the start of the text for four times as long, so that it can be found and read
+unsigned long scrollerPauseAtStartTiming(size_t step, size_t steps, unsigned long delay_millis);
+
+// slows down towards the start of the text and speeds up in the middle, for long texts
+unsigned long scrollerEaseTiming(size_t step, size_t steps, unsigned long delay_millis);
+
 class ScrollerApp : public App {
 public:
-    ScrollerApp(const std::string &text, unsigned long autoscroll_delay_millis);
+    ScrollerApp(const char *text, unsigned long autoscroll_delay_millis, ScrollerTimingCurve timing = scrollerConstantTiming);
+
+    // replaces the text, it is converted to glyphs once and not referenced afterwards
+    void setText(const char *text);
+    // replaces the text with one in flash, it is read directly (not copied to RAM), so it must be valid while the app is used
+    void setText_P(PGM_P text);
 
     virtual void enter() override;
     virtual void handleKeyLeft() override;
     virtual void handleKeyRight() override;
-    virtual void update(AppDisplayInterface &display) override;
+    virtual void handleKeyEvent(const KeyEvent &event) override;
+    virtual bool update(AppDisplayInterface &display) override;
+    virtual unsigned long getUpdateDelay() override;
+    virtual const char *getName() override;
 
 private:
-    const std::string _text;
-    const char *_position;
+    // segment bits of the digits of a RAM text, with their dot in bit 7, followed by the first three digits again (so that each window is contiguous)
+    std::vector<uint8_t> _glyphs;
+    // flash text, nullptr for a RAM text
+    PGM_P _text_P;
+    // number of digits of the text, i.e. the number of scroll steps
+    size_t _steps;
+    size_t _position;
+    // offsets of the digit at _position and of the last digit in the flash text
+    size_t _cursor;
+    size_t _last_cursor;
+    bool _changed;
 
     bool _autoscroll;
     unsigned long _autoscroll_delay_millis;
     unsigned long _last_autoscroll_millis;
+    ScrollerTimingCurve _timing;
+
+    void _reset();
+    void _step(bool forward);
+    size_t _readDigit_P(size_t offset, uint8_t &glyph);
+    unsigned long _getStepDelay();
 };
 
 #endif
@@ -0,0 +1,50 @@
+#ifndef _UDP_PUSH_PACKET_SOURCE_H
+#define _UDP_PUSH_PACKET_SOURCE_H
+
+#include <WiFiUdp.h>
+
+#include <PushPacketSource.h>
+
+// packet source backed by a UDP socket (header-only, because WiFiUDP is not available in native builds)
+class UdpPushPacketSource : public PushPacketSource {
+public:
+    UdpPushPacketSource() : _remote_port(0), _reply_port(0) {
+    }
+
+    void begin(uint16_t port) {
+        _udp.begin(port);
+    }
+
+    virtual size_t receive(uint8_t *data, size_t size) override {
+        int len = _udp.parsePacket();
+        if (len <= 0) {
+            return 0;
+        }
+        _remote_ip = _udp.remoteIP();
+        _remote_port = _udp.remotePort();
+        _udp.read(data, size);
+        return len;
+    }
+
+    virtual void keepSender() override {
+        _reply_ip = _remote_ip;
+        _reply_port = _remote_port;
+    }
+
+    virtual void reply(const uint8_t *data, size_t size) override {
+        if (_reply_port && _udp.beginPacket(_reply_ip, _reply_port)) {
+            _udp.write(data, size);
+            _udp.endPacket();
+        }
+    }
+
+private:
+    WiFiUDP _udp;
+    // sender of the last received packet
+    IPAddress _remote_ip;
+    uint16_t _remote_port;
+    IPAddress _reply_ip;
+    uint16_t _reply_port;
+};
+
+#endif
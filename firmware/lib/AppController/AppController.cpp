@@ -1,93 +1,135 @@
 #include <Arduino.h>
 
-#include <list>
 #include <memory>
 #include <algorithm>
 
 #include <App.h>
 #include <AppController.h>
+#include <AppControllerBase.h>
 #include <HT16K33.h>
-#include <SevenSegment.h>
+#include <KeyEvents.h>
+#include <Frame.h>
+#include <LoopProfiler.h>
 
-AppController::AppController(HT16K33 &display) : _display(display), _current_app(_apps.begin()) {
+AppController::AppController(HT16K33 &display) : AppControllerBase(display), _apps(), _app_count(0), _current_app(_apps) {
 }
 
-void AppController::addApp(std::shared_ptr<App> app) {
-    _apps.push_back(app);
+bool AppController::addApp(std::shared_ptr<App> app) {
+    if (_app_count == APP_CONTROLLER_MAX_APPS) {
+        return false;
+    }
+    bool first = _current_app == _apps + _app_count;
+    _apps[_app_count++] = app;
     app->init(*this);
 
     // if this is the first app, notify it that it has been entered
-    if (_current_app == _apps.end()) {
-        _current_app = _apps.begin();
+    if (first) {
+        _current_app = _apps;
         app->enter();
+        _restoreBrightness();
+        _redraw = true;
     }
+    return true;
 }
 
 void AppController::removeApp(std::shared_ptr<App> app) {
-    auto found = std::find(_apps.begin(), _apps.end(), app);
+    auto found = std::find(_apps, _apps + _app_count, app);
+    if (found == _apps + _app_count) {
+        return;
+    }
 
     if (_current_app == found) {
         _switchToNextApp();
         if (_current_app == found) {
             // last app will be deleted
-            _current_app = _apps.end();
+            _current_app = _apps + _app_count;
+            _restoreBrightness();
+            _redraw = true;
         }
     }
 
-    _apps.erase(found);
+    std::move(found + 1, _apps + _app_count, found);
+    _apps[--_app_count].reset();
+    if (_current_app > found) {
+        _current_app--;
+    }
 }
 
 void AppController::update() {
-    uint16_t keys_old = _display.getKeyColumn(0);
+    _beginUpdate();
 
-    _display.updateKeys();
-
-    uint16_t keys_new = _display.getKeyColumn(0);
-
-    if (_current_app != _apps.end()) {
-        if ((keys_new & 2) && !(keys_old & 2)) {
-            _switchToNextApp();
-        }
+    _handleKeyEvents();
 
-        if ((keys_new & 4) && !(keys_old & 4)) {
-            (*_current_app)->handleKeyLeft();
-        }
+    if (_current_app != _apps + _app_count) {
+        // only push the frame to the display if it has changed, or if another app has been shown before
+        LOOP_PROFILER_START(app_start);
+        bool app_updated = (*_current_app)->update(*this);
+        LOOP_PROFILER_STOP_APP(app_start, (*_current_app)->getName());
 
-        if ((keys_new & 1) && !(keys_old & 1)) {
-            (*_current_app)->handleKeyRight();
+        if (app_updated || _redraw) {
+            _showFrame((*_current_app)->getFrame());
         }
 
-        _display.clearAllLedColumns();
-
-        (*_current_app)->update(*this);
-
-    } else {
-        _display.clearAllLedColumns();
+        _commitScheduledFrame(**_current_app);
+    } else if (_redraw) {
+        Frame empty;
+        empty.clear();
+        _showFrame(empty);
     }
 
-    _display.updateLeds();
-}
-
-void AppController::setBrightness(uint8_t brightness) {
-    _display.setBrightness(brightness);
-}
-
-void AppController::setChar(uint8_t digit, char ch, bool dot, bool case_fallback) {
-    _display.setLedColumn(digit, SevenSegment.getBits(ch, case_fallback) | (dot << 7));
+    _endUpdate();
 }
 
-void AppController::setColon(bool colon) {
-    _display.setLedColumn(4, colon);
+unsigned long AppController::getIdleMillis() {
+    if (_current_app == _apps + _app_count) {
+        return _getIdleMillis(nullptr, ULONG_MAX);
+    }
+    return _getIdleMillis(_current_app->get(), (*_current_app)->getUpdateDelay());
 }
 
 void AppController::_switchToNextApp() {
-    if (_current_app != _apps.end()) {
+    if (_current_app != _apps + _app_count) {
         auto prev = _current_app;
-        if (++_current_app == _apps.end()) {
-            _current_app = _apps.begin();
+        if (++_current_app == _apps + _app_count) {
+            _current_app = _apps;
         }
         if (_current_app != prev) {
             (*_current_app)->enter();
+            _restoreBrightness();
+            _redraw = true;
+        }
+    }
+}
+
+void AppController::_switchToFirstApp() {
+    if (_current_app != _apps + _app_count && _current_app != _apps) {
+        _current_app = _apps;
+        (*_current_app)->enter();
+        _restoreBrightness();
+        _redraw = true;
+    }
+}
+
+void AppController::_handleKeyEvents() {
+    KeyEvent event;
+    while (_popKeyEvent(event)) {
+        // events are dropped while there is no app
+        if (_current_app == _apps + _app_count) {
+            continue;
         }
+
+        if (event.key == APP_KEY_NEXT) {
+            if (event.type == KEY_EVENT_PRESS) {
+                _switchToNextApp();
+            } else if (event.type == KEY_EVENT_LONG_PRESS) {
+                _switchToFirstApp();
+            } else {
+                continue;
+            }
+        } else {
+            (*_current_app)->handleKeyEvent(event);
+        }
+
+        _keyEventHandled(event);
     }
 }
@@ -3,32 +3,37 @@
 
 #include <Arduino.h>
 
-#include <list>
 #include <memory>
 #include <algorithm>
 
 #include <App.h>
+#include <AppControllerBase.h>
 #include <HT16K33.h>
 
-class AppController : public AppDisplayInterface {
+// maximum number of apps, the apps are held in a fixed array, so that adding and removing them doesn't allocate
+#define APP_CONTROLLER_MAX_APPS 6
+
+// controller for apps added and removed at runtime, calls the apps virtually (see StaticAppController for a fixed set of apps)
+class AppController : public AppControllerBase {
 public:
     AppController(HT16K33 &display);
 
-    void addApp(std::shared_ptr<App> app);
+    // returns false (and ignores the app) if APP_CONTROLLER_MAX_APPS apps have been added already
+    bool addApp(std::shared_ptr<App> app);
     void removeApp(std::shared_ptr<App> app);
 
-    void update();
-
-    virtual void setBrightness(uint8_t brightness) override;
-    virtual void setChar(uint8_t digit, char ch, bool dot, bool case_fallback) override;
-    virtual void setColon(bool colon) override;
+    virtual void update() override;
+    virtual unsigned long getIdleMillis() override;
 
 private:
-    HT16K33 &_display;
-    std::list<std::shared_ptr<App>> _apps;
-    decltype(_apps)::iterator _current_app;
+    std::shared_ptr<App> _apps[APP_CONTROLLER_MAX_APPS];
+    size_t _app_count;
+    // points behind the last app if there is no app
+    std::shared_ptr<App> *_current_app;
 
     void _switchToNextApp();
+    void _switchToFirstApp();
+    void _handleKeyEvents();
 };
 
 #endif
@@ -0,0 +1,144 @@
+#include <Arduino.h>
+
+#include <algorithm>
+
+#include <App.h>
+#include <AppControllerBase.h>
+#include <HT16K33.h>
+#include <KeyEvents.h>
+#include <Frame.h>
+#include <LoopProfiler.h>
+
+AppControllerBase::AppControllerBase(HT16K33 &display)
+    : _display(display), _redraw(true), _brightness(15), _brightness_overridden(false), _loop_count(0), _loop_rate(0), _loop_rate_start_millis(0), _commit_errors(),
+      _key_detector(), _key_events(), _key_pending(false), _key_micros(0), _key_latencies() {
+}
+
+uint32_t AppControllerBase::getLoopRate() {
+    return _loop_rate;
+}
+
+const LoopProfilerHistogram &AppControllerBase::getCommitErrors() {
+    return _commit_errors;
+}
+
+const LoopProfilerHistogram &AppControllerBase::getKeyLatencies() {
+    return _key_latencies;
+}
+
+uint32_t AppControllerBase::getDroppedKeyEvents() {
+    return _key_events.getDropped();
+}
+
+void AppControllerBase::setBrightness(uint8_t brightness) {
+    _brightness = brightness;
+    if (!_brightness_overridden) {
+        _display.setBrightness(brightness);
+    }
+}
+
+void AppControllerBase::overrideBrightness(uint8_t brightness) {
+    _brightness_overridden = true;
+    _display.setBrightness(brightness);
+}
+
+void AppControllerBase::_restoreBrightness() {
+    if (_brightness_overridden) {
+        _brightness_overridden = false;
+        _display.setBrightness(_brightness);
+    }
+}
+
+void AppControllerBase::_beginUpdate() {
+    _loop_count++;
+
+    unsigned long cur_millis = millis();
+    if (cur_millis - _loop_rate_start_millis >= 1000) {
+        _loop_rate = _loop_count;
+        _loop_count = 0;
+        _loop_rate_start_millis = cur_millis;
+    }
+
+    LOOP_PROFILER_LOOP();
+
+    LOOP_PROFILER_START(keys_start);
+    bool keys_updated = _display.updateKeys();
+    LOOP_PROFILER_STOP(keys_start, LOOP_PROFILER_UPDATE_KEYS);
+
+    if (keys_updated) {
+        _key_detector.update(_display.getKeyColumn(0), micros(), _key_events);
+    }
+}
+
+bool AppControllerBase::_popKeyEvent(KeyEvent &event) {
+    return _key_events.pop(event);
+}
+
+void AppControllerBase::_keyEventHandled(const KeyEvent &event) {
+    // measure from the oldest unanswered event
+    if (!_key_pending) {
+        _key_pending = true;
+        _key_micros = event.micros;
+    }
+}
+
+void AppControllerBase::_endUpdate() {
+    // key events that didn't change the frame don't have a latency
+    _key_pending = false;
+}
+
+void AppControllerBase::_showFrame(const Frame &frame) {
+    for (uint8_t i = 0; i < 4; i++) {
+        _display.setLedColumn(i, frame.glyphs[i] | (((frame.dots >> i) & 1) << 7));
+    }
+    _display.setLedColumn(4, frame.colon);
+    LOOP_PROFILER_START(leds_start);
+    _display.updateLeds();
+    LOOP_PROFILER_STOP(leds_start, LOOP_PROFILER_UPDATE_LEDS);
+    _redraw = false;
+
+    if (_key_pending) {
+        _key_latencies.add(micros() - _key_micros);
+        _key_pending = false;
+    }
+}
+
+void AppControllerBase::_commitScheduledFrame(App &app) {
+    const Frame *frame;
+    unsigned long commit_micros;
+    if (!app.getScheduledFrame(frame, commit_micros) || (long) (commit_micros - micros()) > APP_CONTROLLER_COMMIT_SPIN_MICROS) {
+        return;
+    }
+
+    // busy wait, short enough to not starve the WiFi stack
+    long remaining_micros = commit_micros - micros();
+    if (remaining_micros > 0) {
+        delayMicroseconds(remaining_micros);
+    }
+    unsigned long error_micros = micros() - commit_micros;
+
+    if (*frame != app.getFrame()) {
+        _showFrame(*frame);
+        _commit_errors.add(error_micros);
+    }
+    app.commitScheduledFrame();
+}
+
+unsigned long AppControllerBase::_getIdleMillis(const App *app, unsigned long app_update_delay) {
+    if (_redraw) {
+        return 0;
+    }
+    unsigned long idle_millis = _display.getKeyScanDelay();
+    if (app) {
+        idle_millis = std::min(idle_millis, app_update_delay);
+
+        // wake up before a scheduled frame is due, and spin for the rest
+        const Frame *frame;
+        unsigned long commit_micros;
+        if (app->getScheduledFrame(frame, commit_micros)) {
+            long remaining_micros = (long) (commit_micros - micros()) - APP_CONTROLLER_COMMIT_SPIN_MICROS;
+            idle_millis = std::min(idle_millis, remaining_micros > 0 ? (unsigned long) remaining_micros / 1000 : 0UL);
+        }
+    }
+    return idle_millis;
+}
@@ -0,0 +1,83 @@
+#ifndef _APP_CONTROLLER_BASE_H
+#define _APP_CONTROLLER_BASE_H
+
+#include <Arduino.h>
+
+#include <App.h>
+#include <Frame.h>
+#include <HT16K33.h>
+#include <KeyEvents.h>
+#include <LoopProfiler.h>
+
+// scheduled frames are committed by spinning if they are due within this time, update should be called earlier (see getIdleMillis)
+#define APP_CONTROLLER_COMMIT_SPIN_MICROS 2000
+
+// key scanning, frame output and statistics shared by AppController (apps added at runtime) and StaticAppController (apps fixed at compile time)
+class AppControllerBase : public AppDisplayInterface {
+public:
+    virtual void update() = 0;
+
+    // returns the number of milliseconds until update needs to be called again (key scanning or app update)
+    virtual unsigned long getIdleMillis() = 0;
+
+    // returns the number of update calls during the last full second
+    uint32_t getLoopRate();
+
+    // returns the distribution of the delay from the scheduled time until the LED update of scheduled frames has been issued
+    const LoopProfilerHistogram &getCommitErrors();
+
+    // returns the distribution of the delay from the key sample until the LED update caused by a key event has been issued
+    const LoopProfilerHistogram &getKeyLatencies();
+
+    // returns the number of key events dropped because the queue was full
+    uint32_t getDroppedKeyEvents();
+
+    virtual void setBrightness(uint8_t brightness) override;
+    virtual void overrideBrightness(uint8_t brightness) override;
+
+protected:
+    HT16K33 &_display;
+    // true iff the display doesn't show the frame of the current app
+    bool _redraw;
+
+    AppControllerBase(HT16K33 &display);
+    virtual ~AppControllerBase() = default; // prevent delete on pointers to this type
+
+    // counts the loop and scans the keys, must be called first by update
+    void _beginUpdate();
+
+    // returns the next key event, the caller must call _keyEventHandled if it has been handled
+    bool _popKeyEvent(KeyEvent &event);
+    void _keyEventHandled(const KeyEvent &event);
+
+    // must be called last by update
+    void _endUpdate();
+
+    // must be called when another app has been entered
+    void _restoreBrightness();
+
+    void _showFrame(const Frame &frame);
+    void _commitScheduledFrame(App &app);
+
+    // returns the idle time for the given app (nullptr if there is none) and its update delay
+    unsigned long _getIdleMillis(const App *app, unsigned long app_update_delay);
+
+private:
+    uint8_t _brightness;
+    bool _brightness_overridden;
+
+    uint32_t _loop_count;
+    uint32_t _loop_rate;
+    unsigned long _loop_rate_start_millis;
+
+    LoopProfilerHistogram _commit_errors;
+
+    KeyEventDetector _key_detector;
+    KeyEventQueue _key_events;
+    // true iff a key event has been handled during the current update, and the display hasn't been updated since
+    bool _key_pending;
+    unsigned long _key_micros;
+    LoopProfilerHistogram _key_latencies;
+};
+
+#endif
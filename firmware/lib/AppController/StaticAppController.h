@@ -0,0 +1,134 @@
+#ifndef _STATIC_APP_CONTROLLER_H
+#define _STATIC_APP_CONTROLLER_H
+
+#include <Arduino.h>
+
+#include <stddef.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <App.h>
+#include <AppControllerBase.h>
+#include <HT16K33.h>
+#include <KeyEvents.h>
+#include <LoopProfiler.h>
+
+// controller for a set of apps fixed at compile time, stored inline in the given order
+// the apps are called with qualified names, so there are no virtual calls (and no heap or reference counting)
+template <typename... Apps>
+class StaticAppController : public AppControllerBase {
+    static_assert(sizeof...(Apps) > 0, "at least one app is required");
+
+public:
+    // the apps are moved into the controller
+    template <typename... Args>
+    StaticAppController(HT16K33 &display, Args &&...apps) : AppControllerBase(display), _apps(std::forward<Args>(apps)...), _current_app(0) {
+    }
+
+    // initializes the apps and enters the first one, must be called before the first update (and can be called again to start over)
+    void begin() {
+        _forEachApp([this](auto &app) {
+            using AppType = typename std::remove_reference<decltype(app)>::type;
+            app.AppType::init(*this);
+        });
+        _current_app = 0;
+        _enterCurrentApp();
+    }
+
+    template <size_t I>
+    typename std::tuple_element<I, std::tuple<Apps...>>::type &getApp() {
+        return std::get<I>(_apps);
+    }
+
+    virtual void update() override {
+        _beginUpdate();
+
+        KeyEvent event;
+        while (_popKeyEvent(event)) {
+            if (event.key == APP_KEY_NEXT) {
+                if (event.type == KEY_EVENT_PRESS) {
+                    _switchToApp(_current_app + 1 < sizeof...(Apps) ? _current_app + 1 : 0);
+                } else if (event.type == KEY_EVENT_LONG_PRESS) {
+                    _switchToApp(0);
+                } else {
+                    continue;
+                }
+            } else {
+                _visitCurrentApp([&event](auto &app) {
+                    using AppType = typename std::remove_reference<decltype(app)>::type;
+                    app.AppType::handleKeyEvent(event);
+                });
+            }
+            _keyEventHandled(event);
+        }
+
+        _visitCurrentApp([this](auto &app) {
+            using AppType = typename std::remove_reference<decltype(app)>::type;
+
+            // only push the frame to the display if it has changed, or if another app has been shown before
+            LOOP_PROFILER_START(app_start);
+            bool app_updated = app.AppType::update(*this);
+            LOOP_PROFILER_STOP_APP(app_start, app.AppType::getName());
+
+            if (app_updated || _redraw) {
+                _showFrame(app.getFrame());
+            }
+
+            _commitScheduledFrame(app);
+        });
+
+        _endUpdate();
+    }
+
+    virtual unsigned long getIdleMillis() override {
+        unsigned long idle_millis = 0;
+        _visitCurrentApp([this, &idle_millis](auto &app) {
+            using AppType = typename std::remove_reference<decltype(app)>::type;
+            idle_millis = _getIdleMillis(&app, app.AppType::getUpdateDelay());
+        });
+        return idle_millis;
+    }
+
+private:
+    std::tuple<Apps...> _apps;
+    size_t _current_app;
+
+    void _switchToApp(size_t index) {
+        if (index != _current_app) {
+            _current_app = index;
+            _enterCurrentApp();
+        }
+    }
+
+    void _enterCurrentApp() {
+        _visitCurrentApp([](auto &app) {
+            using AppType = typename std::remove_reference<decltype(app)>::type;
+            app.AppType::enter();
+        });
+        _restoreBrightness();
+        _redraw = true;
+    }
+
+    // calls the function with the current app, with its actual type (compiles to a chain of comparisons)
+    template <size_t I = 0, typename Function>
+    void _visitCurrentApp(Function &&function) {
+        if constexpr (I < sizeof...(Apps)) {
+            if (_current_app == I) {
+                function(std::get<I>(_apps));
+            } else {
+                _visitCurrentApp<I + 1>(function);
+            }
+        }
+    }
+
+    template <size_t I = 0, typename Function>
+    void _forEachApp(Function &&function) {
+        if constexpr (I < sizeof...(Apps)) {
+            function(std::get<I>(_apps));
+            _forEachApp<I + 1>(function);
+        }
+    }
+};
+
+#endif
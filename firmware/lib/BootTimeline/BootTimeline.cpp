@@ -0,0 +1,71 @@
+#include <Arduino.h>
+
+#include <BootTimeline.h>
+
+static BootTimelineEvent boot_timeline_events[BOOT_TIMELINE_MAX_EVENTS];
+static size_t boot_timeline_count = 0;
+static size_t boot_timeline_dropped = 0;
+
+void BootTimeline::mark(PGM_P name) {
+    uint32_t cycles = ESP.getCycleCount();
+    if (boot_timeline_count >= BOOT_TIMELINE_MAX_EVENTS) {
+        boot_timeline_dropped++;
+        return;
+    }
+    boot_timeline_events[boot_timeline_count++] = { name, cycles, (uint32_t) millis() };
+}
+
+size_t BootTimeline::getCount() {
+    return boot_timeline_count;
+}
+
+size_t BootTimeline::getDropped() {
+    return boot_timeline_dropped;
+}
+
+const BootTimelineEvent &BootTimeline::getEvent(size_t index) {
+    return boot_timeline_events[index];
+}
+
+uint64_t BootTimeline::getMicros(const BootTimelineEvent &event) {
+    uint32_t cycles_per_micro = ESP.getCpuFreqMHz();
+
+    // the millisecond timestamp is exact enough to determine the number of wraps of the cycle counter
+    // (rounded, because both counters don't start at exactly the same time)
+    int64_t diff = (int64_t) event.millis * 1000 * cycles_per_micro - event.cycles;
+    uint64_t wraps = (uint64_t) (diff + (1LL << 31)) >> 32;
+
+    return ((wraps << 32) + event.cycles) / cycles_per_micro;
+}
+
+size_t BootTimeline::format(char *buffer, size_t size, size_t first) {
+    size_t length = 0;
+    uint64_t previous_micros = first > 0 && first <= boot_timeline_count ? getMicros(boot_timeline_events[first - 1]) : 0;
+
+    for (size_t i = first; i < boot_timeline_count; i++) {
+        const BootTimelineEvent &event = boot_timeline_events[i];
+        uint64_t micros = getMicros(event);
+
+        char name[24];
+        strncpy_P(name, event.name, sizeof(name) - 1);
+        name[sizeof(name) - 1] = 0;
+
+        // absolute and delta time in milliseconds with microsecond resolution
+        int len = snprintf_P(length < size ? buffer + length : nullptr, length < size ? size - length : 0, PSTR("%7lu.%03lu +%6lu.%03lu %s\n"),
+            (unsigned long) (micros / 1000), (unsigned long) (micros % 1000),
+            (unsigned long) ((micros - previous_micros) / 1000), (unsigned long) ((micros - previous_micros) % 1000), name);
+        if (len > 0) {
+            length += len;
+        }
+        previous_micros = micros;
+    }
+
+    if (boot_timeline_dropped && first <= boot_timeline_count) {
+        int len = snprintf_P(length < size ? buffer + length : nullptr, length < size ? size - length : 0, PSTR("(%lu dropped)\n"), (unsigned long) boot_timeline_dropped);
+        if (len > 0) {
+            length += len;
+        }
+    }
+
+    return length;
+}
@@ -0,0 +1,40 @@
+#ifndef _BOOT_TIMELINE_H
+#define _BOOT_TIMELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Arduino.h>
+
+#define BOOT_TIMELINE_MAX_EVENTS 16
+
+// buffer size sufficient for the formatted timeline (48 characters per event, plus the dropped events line)
+#define BOOT_TIMELINE_FORMAT_SIZE (BOOT_TIMELINE_MAX_EVENTS * 48 + 32)
+
+struct BootTimelineEvent {
+    PGM_P name;
+    // CPU cycles since reset (wraps after 2^32 cycles, i.e. 53s at 80MHz), and milliseconds since reset to resolve the wraps
+    uint32_t cycles;
+    uint32_t millis;
+};
+
+// records named boot phases with cycle counter timestamps into fixed storage
+// events beyond BOOT_TIMELINE_MAX_EVENTS are counted, but not recorded
+class BootTimeline {
+public:
+    // records an event, the name must be a PROGMEM string (e.g. PSTR("name")) that is valid until reset
+    static void mark(PGM_P name);
+
+    static size_t getCount();
+    static size_t getDropped();
+    static const BootTimelineEvent &getEvent(size_t index);
+
+    // returns the time of the event in microseconds since reset
+    static uint64_t getMicros(const BootTimelineEvent &event);
+
+    // formats the timeline (one event per line, starting at the given event) into the buffer like snprintf
+    // returns the length of the complete output
+    static size_t format(char *buffer, size_t size, size_t first = 0);
+};
+
+#endif
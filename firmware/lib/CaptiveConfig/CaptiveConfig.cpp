@@ -1,8 +1,11 @@
+#include <limits.h>
 #include <time.h>
 
-#include "CaptiveConfig.h"
+#include <BootTimeline.h>
+#include <WebServerTemplateSink.h>
 
-#define CAPTIVE_CONFIG_MAGIC 0x51d3b00b
+#include "CaptiveConfig.h"
+#include "CaptiveConfigAssets.h"
 
 #define CAPTIVE_CONFIG_SSID_PARAM_NAME "ssid"
 #define CAPTIVE_CONFIG_PASSPHRASE_PARAM_NAME "passphrase"
@@ -12,136 +15,66 @@
 #define CAPTIVE_CONFIG_SNTP_SERVER_2_PARAM_NAME "sntp-server-2"
 #define CAPTIVE_CONFIG_TZ_PARAM_NAME "tz"
 
-const char CAPTIVE_CONFIG_PAGE_URI[] PROGMEM = "/_captive/config";
-
-struct CaptiveConfigPersistentDataHeader {
-    uint32_t magic = 0;
-    uint16_t version = 0;
-} __attribute__((packed));
-
-struct CaptiveConfigDataPersistentV1 {
-    static const uint16_t VERSION = 1;
-
-    CaptiveConfigPersistentDataHeader header;
-    char ssid[CAPTIVE_CONFIG_SSID_MAX_LENGTH + 1];
-    char passphrase[CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH + 1];
-    char sntp_server[3][CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH + 1];
-    char tz[CAPTIVE_CONFIG_TZ_MAX_LENGTH + 1];
-
-    void init() {
-        header.magic = CAPTIVE_CONFIG_MAGIC;
-        header.version = VERSION;
-        ssid[0] = 0;
-        passphrase[0] = 0;
-        strncpy(sntp_server[0], "0.de.pool.ntp.org", sizeof(sntp_server[0]));
-        strncpy(sntp_server[1], "1.de.pool.ntp.org", sizeof(sntp_server[1]));
-        strncpy(sntp_server[2], "2.de.pool.ntp.org", sizeof(sntp_server[2]));
-        strncpy(tz, "CET-1CEST,M3.5.0,M10.5.0/3", sizeof(tz));
-    }
-} __attribute__((packed));
-
-struct CaptiveConfigDataPersistentV2 {
-    static const uint16_t VERSION = 2;
-
-    CaptiveConfigPersistentDataHeader header;
-    char ssid[CAPTIVE_CONFIG_SSID_MAX_LENGTH + 1];
-    char passphrase[CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH + 1];
-    char hostname[CAPTIVE_CONFIG_HOSTNAME_MAX_LENGTH + 1];
-    char sntp_server[3][CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH + 1];
-    char tz[CAPTIVE_CONFIG_TZ_MAX_LENGTH + 1];
-
-    void migrateFrom(const CaptiveConfigDataPersistentV1 &v1) {
-        header.magic = CAPTIVE_CONFIG_MAGIC;
-        header.version = VERSION;
-        strncpy(ssid, v1.ssid, sizeof(ssid));
-        strncpy(passphrase, v1.passphrase, sizeof(passphrase));
-        strncpy(sntp_server[0], v1.sntp_server[0], sizeof(sntp_server[0]));
-        strncpy(sntp_server[1], v1.sntp_server[1], sizeof(sntp_server[1]));
-        strncpy(sntp_server[2], v1.sntp_server[2], sizeof(sntp_server[2]));
-        strncpy(tz, v1.tz, sizeof(tz));
-
-        char newHostname[17];
-        snprintf_P(newHostname, sizeof(newHostname), PSTR("wificlock-%06x"), ESP.getChipId() & 0xFFFFFF);
-        strncpy(hostname, newHostname, sizeof(hostname));
-    }
-} __attribute__((packed));
-
-using CaptiveConfigDataPersistentLatest = CaptiveConfigDataPersistentV2;
-
-CaptiveConfigData createTransientFromPersistent(const CaptiveConfigDataPersistentLatest &persistent) {
-    CaptiveConfigData transient;
-    strncpy(transient.ssid, persistent.ssid, sizeof(transient.ssid));
-    strncpy(transient.passphrase, persistent.passphrase, sizeof(transient.passphrase));
-    strncpy(transient.hostname, persistent.hostname, sizeof(transient.hostname));
-    strncpy(transient.sntp_server[0], persistent.sntp_server[0], sizeof(transient.sntp_server[0]));
-    strncpy(transient.sntp_server[1], persistent.sntp_server[1], sizeof(transient.sntp_server[1]));
-    strncpy(transient.sntp_server[2], persistent.sntp_server[2], sizeof(transient.sntp_server[2]));
-    strncpy(transient.tz, persistent.tz, sizeof(transient.tz));
-    return transient;
-}
+// time between responding to a successful POST and leaving config mode, so that the response reaches the client
+#define CAPTIVE_CONFIG_LEAVE_DELAY_MILLIS 1000
 
-CaptiveConfigDataPersistentLatest createPersistentFromTransient(const CaptiveConfigData &transient) {
-    CaptiveConfigDataPersistentLatest persistent;
-    persistent.header.magic = CAPTIVE_CONFIG_MAGIC;
-    persistent.header.version = CaptiveConfigDataPersistentLatest::VERSION;
-    strncpy(persistent.ssid, transient.ssid, sizeof(persistent.ssid));
-    strncpy(persistent.passphrase, transient.passphrase, sizeof(persistent.passphrase));
-    strncpy(persistent.hostname, transient.hostname, sizeof(persistent.hostname));
-    strncpy(persistent.sntp_server[0], transient.sntp_server[0], sizeof(persistent.sntp_server[0]));
-    strncpy(persistent.sntp_server[1], transient.sntp_server[1], sizeof(persistent.sntp_server[1]));
-    strncpy(persistent.sntp_server[2], transient.sntp_server[2], sizeof(persistent.sntp_server[2]));
-    strncpy(persistent.tz, transient.tz, sizeof(persistent.tz));
-    return persistent;
-}
+// time to connect using the network cache before falling back to a full scan and DHCP
+#define CAPTIVE_CONFIG_FAST_CONNECT_TIMEOUT_MILLIS 5000
+// time after connecting using the network cache until the lease is renewed using DHCP
+#define CAPTIVE_CONFIG_LEASE_RENEW_DELAY_MILLIS 60000
 
-CaptiveConfig::CaptiveConfig(DNSServer &dns_server, ESP8266WebServer &web_server)
-    : _dns_server(dns_server), _web_server(web_server) {
+const char CAPTIVE_CONFIG_PAGE_URI[] PROGMEM = "/_captive/config";
+const char CAPTIVE_CONFIG_STYLE_URI[] PROGMEM = "/_captive/style.css";
+
+// static assets are cached by the client, the ETag changes whenever their content changes
+const char CAPTIVE_CONFIG_ASSET_CACHE_CONTROL[] PROGMEM = "public, max-age=31536000, immutable";
+
+const char CAPTIVE_CONFIG_PAGE_HEADER_TEMPLATE[] PROGMEM =
+    "<!DOCTYPE html>"
+    "<html lang=\"en\">"
+    "<head>"
+        "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/>"
+        "<title>Captive Config</title>"
+        "<link rel=\"stylesheet\" href=\"/_captive/style.css\"/>"
+    "</head>"
+    "<body>"
+        "<form action=\"\" method=\"POST\">";
+
+const char CAPTIVE_CONFIG_PAGE_FOOTER_TEMPLATE[] PROGMEM =
+            "<button id=\"btn\" type=\"submit\">Save</button>"
+        "</form>"
+    "</body>"
+    "</html>";
+
+// {0}: legend
+const char CAPTIVE_CONFIG_FIELDSET_START_TEMPLATE[] PROGMEM =
+    "<fieldset>"
+        "<legend>{0}</legend>";
+
+const char CAPTIVE_CONFIG_FIELDSET_END_TEMPLATE[] PROGMEM =
+    "</fieldset>";
+
+// {0}: label, {1}: type, {2}: name (also used as id), {3}: max length, {4}: value
+const char CAPTIVE_CONFIG_INPUT_TEMPLATE[] PROGMEM =
+    "<label for=\"{2}\">{0}</label>"
+    "<input type=\"{1}\" id=\"{2}\" name=\"{2}\" maxlength=\"{3}\" value=\"{4}\"/>";
+
+CaptiveConfig::CaptiveConfig(DNSServer &dns_server, ESP8266WebServer &web_server, CaptiveConfigStore &store)
+    : _dns_server(dns_server), _web_server(web_server), _store(store), _config_mode(false), _leave_config_mode_pending(false), _leave_config_mode_millis(0),
+      _network_cache_valid(false), _network_cache_dirty(false), _fast_connect(_CAPTIVE_CONFIG_FAST_CONNECT_NONE), _fast_connect_millis(0),
+      _connect_stats { false, false, 0 } {
 }
 
 void CaptiveConfig::begin(const char *ap_ssid, const char *ap_passphrase, bool force_config_mode) {
-    CaptiveConfigPersistentDataHeader header;
-    EEPROM.begin(sizeof(header));
-    EEPROM.get(0, header);
-    EEPROM.end();
-
-    uint16_t cur_version = 0;
-
-    // initialize or read version 1
-    CaptiveConfigDataPersistentV1 v1;
-    if (header.magic != CAPTIVE_CONFIG_MAGIC) {
-        // initialize config if magic number is not found in EEPROM
-        v1.init();
-        cur_version = CaptiveConfigDataPersistentV1::VERSION;
-    } else if (header.version == CaptiveConfigDataPersistentV1::VERSION) {
-        EEPROM.begin(sizeof(v1));
-        EEPROM.get(0, v1);
-        EEPROM.end();
-        cur_version = CaptiveConfigDataPersistentV1::VERSION;
-    }
-
-    // migrate or read version 2
-    CaptiveConfigDataPersistentV2 v2;
-    if (cur_version == CaptiveConfigDataPersistentV1::VERSION) {
-        v2.migrateFrom(v1);
-        cur_version = CaptiveConfigDataPersistentV2::VERSION;
-    } else if (header.version == CaptiveConfigDataPersistentV2::VERSION) {
-        EEPROM.begin(sizeof(v2));
-        EEPROM.get(0, v2);
-        EEPROM.end();
-        cur_version = CaptiveConfigDataPersistentV2::VERSION;
-    }
+    this->_data = this->_store.load();
+    this->_network_cache_valid = this->_store.loadNetworkCache(this->_network_cache);
+    BootTimeline::mark(PSTR("config loaded"));
 
-    // reset default config if version is not latest after migration
-    if (cur_version != CaptiveConfigDataPersistentLatest::VERSION) {
-        v1.init();
-        v2.migrateFrom(v1);
-    }
-    CaptiveConfigDataPersistentLatest latest = v2;
-
-    // convert to transient representation
-    this->_data = createTransientFromPersistent(latest);
+    this->_got_ip_handler = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP &event) {
+        this->_handleGotIP();
+    });
 
-    // WiFi config is stored in EEPROM, don't store it in Flash
+    // WiFi config is stored by CaptiveConfigStore, don't let the SDK store it in Flash
     WiFi.persistent(false);
     WiFi.setAutoConnect(false);
     WiFi.setAutoReconnect(true);
@@ -153,7 +86,8 @@ void CaptiveConfig::begin(const char *ap_ssid, const char *ap_passphrase, bool f
     this->_config_mode = force_config_mode || !this->_data.ssid[0] || !this->_data.passphrase[0];
 
     if (this->_config_mode) {
-        // enable AP
+        // enable AP only, the station is started when config mode is left
+        // (the soft AP has to follow the station's channel, so a station scanning for a wrong or missing network would drop the portal's clients)
         WiFi.softAP(ap_ssid, ap_passphrase);
 
         // start DNS server for captive portal
@@ -161,37 +95,65 @@ void CaptiveConfig::begin(const char *ap_ssid, const char *ap_passphrase, bool f
         this->_dns_server.start(53, "*", WiFi.softAPIP());
 
         // configure web server handlers
+        // the handlers can't be removed from the web server, so they answer with 404 after config mode has been left
         this->_web_server.onNotFound([this] {
-            if (!this->handleCaptivePortal()) {
+            if (!this->_config_mode || !this->handleCaptivePortal()) {
                 this->handleNotFound();
             }
         });
         this->_web_server.on(FPSTR(CAPTIVE_CONFIG_PAGE_URI), HTTP_GET, [this] {
-            if (!this->handleCaptivePortal()) {
+            if (!this->_config_mode) {
+                this->handleNotFound();
+            } else if (!this->handleCaptivePortal()) {
                 this->handleGetConfigPage();
             }
         });
         this->_web_server.on(FPSTR(CAPTIVE_CONFIG_PAGE_URI), HTTP_POST, [this] {
-            if (!this->handleCaptivePortal()) {
+            if (!this->_config_mode) {
+                this->handleNotFound();
+            } else if (!this->handleCaptivePortal()) {
                 this->handlePostConfigPage();
             }
         });
 
+        this->_web_server.on(FPSTR(CAPTIVE_CONFIG_STYLE_URI), HTTP_GET, [this] {
+            if (!this->_config_mode) {
+                this->handleNotFound();
+            } else if (!this->handleCaptivePortal()) {
+                this->handleGetStyle();
+            }
+        });
+
+        // required to answer conditional requests for static assets
+        const char *collected_headers[] = { "If-None-Match" };
+        this->_web_server.collectHeaders(collected_headers, 1);
+
         // start web server for captive portal
         this->_web_server.begin();
+        BootTimeline::mark(PSTR("config mode started"));
     } else {
-        // enable STA with configured network and hostname (must be done in this order)
-        WiFi.enableSTA(true);
-        WiFi.hostname(this->_data.hostname);
-        WiFi.begin(this->_data.ssid, this->_data.passphrase);
+        this->_startStation();
     }
 }
 
+void CaptiveConfig::applyTimeConfig() {
+    configTime(this->_data.tz, this->_data.sntp_server[0], this->_data.sntp_server[1], this->_data.sntp_server[2]);
+}
+
+void CaptiveConfig::onConfigModeLeft(std::function<void()> callback) {
+    this->_config_mode_left_callback = callback;
+}
+
 bool CaptiveConfig::handleCaptivePortal() {
-    String host = this->_web_server.hostHeader();
-    String local_ip = this->_web_server.client().localIP().toString();
-    if (host != local_ip) {
-        this->_web_server.sendHeader(String(F("Location")), String(F("http://")) + local_ip + String(FPSTR(CAPTIVE_CONFIG_PAGE_URI)));
+    // called for every request of the captive portal (clients probe frequently), so avoid temporary Strings
+    IPAddress ip = this->_web_server.client().localIP();
+    char local_ip[16];
+    snprintf_P(local_ip, sizeof(local_ip), PSTR("%u.%u.%u.%u"), ip[0], ip[1], ip[2], ip[3]);
+    if (strcmp(this->_web_server.hostHeader().c_str(), local_ip)) {
+        char location[48];
+        snprintf_P(location, sizeof(location), PSTR("http://%s"), local_ip);
+        strncat_P(location, CAPTIVE_CONFIG_PAGE_URI, sizeof(location) - strlen(location) - 1);
+        this->_web_server.sendHeader(F("Location"), location);
         this->_web_server.setContentLength(0);
         this->_web_server.send(302, "text/plain", "");
         return true;
@@ -208,28 +170,28 @@ void CaptiveConfig::handleGetConfigPage() {
         return;
     }
 
+    // render once without output to determine the exact content length
+    TemplateWriter counter;
+    this->_renderConfigPage(counter);
+
     this->_web_server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     this->_web_server.sendHeader("Pragma", "no-cache");
     this->_web_server.sendHeader("Expires", "-1");
-    this->_web_server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    this->_web_server.setContentLength(counter.getLength());
     this->_web_server.send(200, "text/html", "");
 
-    this->_sendConfigPageHtml([this] {
-        this->_sendFieldset("WiFi", [this]() {
-            this->_sendTextInput("SSID", CAPTIVE_CONFIG_SSID_PARAM_NAME, CAPTIVE_CONFIG_SSID_MAX_LENGTH, this->_data.ssid);
-            this->_sendPasswordInput("Passphrase (empty to keep)", CAPTIVE_CONFIG_PASSPHRASE_PARAM_NAME, CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH, "");
-            this->_sendTextInput("Hostname", CAPTIVE_CONFIG_HOSTNAME_PARAM_NAME, CAPTIVE_CONFIG_HOSTNAME_MAX_LENGTH, this->_data.hostname);
-        });
-        this->_sendFieldset("Time", [this]() {
-            this->_sendTextInput("SNTP Server (primary)", CAPTIVE_CONFIG_SNTP_SERVER_0_PARAM_NAME, CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH, this->_data.sntp_server[0]);
-            this->_sendTextInput("SNTP Server (1st fallback)", CAPTIVE_CONFIG_SNTP_SERVER_1_PARAM_NAME, CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH, this->_data.sntp_server[1]);
-            this->_sendTextInput("SNTP Server (2nd fallback)", CAPTIVE_CONFIG_SNTP_SERVER_2_PARAM_NAME, CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH, this->_data.sntp_server[2]);
-            this->_sendTextInput("TZ", CAPTIVE_CONFIG_TZ_PARAM_NAME, CAPTIVE_CONFIG_TZ_MAX_LENGTH, this->_data.tz);
-        });
-    });
+    WebServerTemplateSink sink(this->_web_server);
+    TemplateWriter writer(&sink);
+    this->_renderConfigPage(writer);
+    writer.flush();
+}
+
+void CaptiveConfig::handleGetStyle() {
+    if (this->handleCaptivePortal()) {
+        return;
+    }
 
-    // stop client (required because content-length is unknown)
-    this->_web_server.client().stop();
+    this->_sendGzipAsset(PSTR("text/css"), CAPTIVE_CONFIG_STYLE_CSS_GZ, sizeof(CAPTIVE_CONFIG_STYLE_CSS_GZ), CAPTIVE_CONFIG_STYLE_CSS_ETAG);
 }
 
 void CaptiveConfig::handlePostConfigPage() {
@@ -247,21 +209,19 @@ void CaptiveConfig::handlePostConfigPage() {
 
     // TODO validate params
 
+    CaptiveConfigData previous = this->_data;
+
     strncpy(this->_data.ssid, ssid.c_str(), sizeof(this->_data.ssid));
     if (!passphrase.isEmpty()) {
         strncpy(this->_data.passphrase, passphrase.c_str(), sizeof(this->_data.passphrase));
     }
     strncpy(this->_data.hostname, hostname.c_str(), sizeof(this->_data.hostname));
     strncpy(this->_data.sntp_server[0], sntp_server_0.c_str(), sizeof(this->_data.sntp_server[0]));
-    strncpy(this->_data.sntp_server[0], sntp_server_1.c_str(), sizeof(this->_data.sntp_server[1]));
+    strncpy(this->_data.sntp_server[1], sntp_server_1.c_str(), sizeof(this->_data.sntp_server[1]));
     strncpy(this->_data.sntp_server[2], sntp_server_2.c_str(), sizeof(this->_data.sntp_server[2]));
     strncpy(this->_data.tz, tz.c_str(), sizeof(this->_data.tz));
 
-    // convert configuration to persistent EEPROM layout
-    CaptiveConfigDataPersistentLatest persistent = createPersistentFromTransient(this->_data);
-    EEPROM.begin(sizeof(persistent));
-    EEPROM.put(0, persistent);
-    EEPROM.end();
+    this->_store.save(this->_data);
 
     this->_web_server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     this->_web_server.sendHeader("Pragma", "no-cache");
@@ -273,26 +233,23 @@ void CaptiveConfig::handlePostConfigPage() {
         "<head>"
             "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/>"
             "<title>Captive Config Saved</title>"
-            "<style>"
-                "body{font-family:Verdana,sans-serif;padding:0.5em;}"
-                "div{border:1px solid #000;border-radius:0.5rem;margin:0;width:100%;box-sizing:border-box;}"
-                "p{margin:0.5rem;}"
-            "</style>"
+            "<link rel=\"stylesheet\" href=\"/_captive/style.css\"/>"
         "</head>"
         "<body>"
             "<div>"
-                "<p>Configuation has been saved.<p>"
-                "<p>Device will be restarted.</p>"
+                "<p>Configuration has been saved.</p>"
+                "<p>Device will connect to the configured network.</p>"
             "</div>"
         "</body>"
         "</html>"
     ));
 
-    // stop client to finish response immediately
-    this->_web_server.client().stop();
-
-    // restart the thing
-    ESP.restart();
+    // apply the changes without restarting, config mode is left when the response has been delivered
+    this->_applyChanges(previous);
+    if (this->_data.ssid[0] && this->_data.passphrase[0]) {
+        this->_leave_config_mode_pending = true;
+        this->_leave_config_mode_millis = millis();
+    }
 }
 
 const CaptiveConfigData &CaptiveConfig::getData() {
@@ -303,86 +260,212 @@ void CaptiveConfig::doLoop() {
     if (this->_config_mode) {
         this->_dns_server.processNextRequest();
         this->_web_server.handleClient();
+
+        if (this->_leave_config_mode_pending && millis() - this->_leave_config_mode_millis >= CAPTIVE_CONFIG_LEAVE_DELAY_MILLIS) {
+            this->_leaveConfigMode();
+        }
+    }
+
+    switch (this->_fast_connect) {
+    case _CAPTIVE_CONFIG_FAST_CONNECT_NONE:
+        break;
+    case _CAPTIVE_CONFIG_FAST_CONNECT_CONNECTING:
+        if (millis() - this->_fast_connect_millis >= CAPTIVE_CONFIG_FAST_CONNECT_TIMEOUT_MILLIS) {
+            // access point or lease is gone, fall back to a full scan and DHCP
+            BootTimeline::mark(PSTR("fast connect timeout"));
+            this->_network_cache_valid = false;
+            this->_fast_connect = _CAPTIVE_CONFIG_FAST_CONNECT_NONE;
+            WiFi.disconnect();
+            WiFi.config(0U, 0U, 0U);
+            WiFi.begin(this->_data.ssid, this->_data.passphrase);
+        }
+        break;
+    case _CAPTIVE_CONFIG_FAST_CONNECT_CONNECTED:
+        if (millis() - this->_fast_connect_millis >= CAPTIVE_CONFIG_LEASE_RENEW_DELAY_MILLIS) {
+            // switch to DHCP, so that the lease is renewed with the DHCP server
+            this->_fast_connect = _CAPTIVE_CONFIG_FAST_CONNECT_NONE;
+            WiFi.config(0U, 0U, 0U);
+        }
+        break;
+    }
+
+    if (this->_network_cache_dirty) {
+        // saved here instead of in the event handler, which runs in the SDK's context
+        this->_network_cache_dirty = false;
+        this->_saveNetworkCache();
+    }
+}
+
+unsigned long CaptiveConfig::getIdleMillis() {
+    // DNS and web server are polled in config mode, the WiFi stack runs in the background otherwise
+    if (this->_config_mode || this->_network_cache_dirty) {
+        return 0;
     }
+    // fast connect timeouts only need coarse polling
+    return this->_fast_connect != _CAPTIVE_CONFIG_FAST_CONNECT_NONE ? 100 : ULONG_MAX;
+}
+
+const CaptiveConfigConnectStats &CaptiveConfig::getConnectStats() {
+    return this->_connect_stats;
 }
 
 bool CaptiveConfig::isConfigMode() {
     return this->_config_mode;
 }
 
-void CaptiveConfig::_sendConfigPageHtml(const std::function<void()> &inner) {
-    this->_web_server.sendContent(F(
-        "<!DOCTYPE html>"
-        "<html lang=\"en\">"
-        "<head>"
-            "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/>"
-            "<title>Captive Config</title>"
-            "<style>"
-                "body{font-family:Verdana,sans-serif;padding:0.5em;}"
-                "fieldset{border:1px solid #000;border-radius:0.5rem;margin:0;margin-bottom:0.5rem;width:100%;box-sizing:border-box;}"
-                "label{display:block;font-size:1rem;margin:0.25rem 0;padding:0.25rem;}"
-                "input{display:block;font-size:1rem;margin:0.5rem 0;padding:0.25rem;width:100%;box-sizing:border-box;}"
-                "button{font-size:1rem;margin:1em 0 0 0;border:0;padding:1rem;width:100%;border-radius:0.5rem;background-color:#323f77;color:#fff;}"
-            "</style>"
-        "</head>"
-        "<body>"
-            "<form action=\"\" method=\"POST\">"
-    ));
+void CaptiveConfig::_startStation() {
+    // enable STA with configured network and hostname (must be done in this order)
+    WiFi.enableSTA(true);
+    // modem sleep between DTIM beacons, light sleep would delay wake-ups for display updates
+    WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+    WiFi.hostname(this->_data.hostname);
+
+    if (this->_network_cache_valid && !strcmp(this->_network_cache.ssid, this->_data.ssid)) {
+        // join the known access point directly and reuse the lease, skipping the scan and DHCP
+        WiFi.config(IPAddress(this->_network_cache.ip), IPAddress(this->_network_cache.gateway), IPAddress(this->_network_cache.netmask),
+            IPAddress(this->_network_cache.dns[0]), IPAddress(this->_network_cache.dns[1]));
+        WiFi.begin(this->_data.ssid, this->_data.passphrase, this->_network_cache.channel, this->_network_cache.bssid);
+        this->_fast_connect = _CAPTIVE_CONFIG_FAST_CONNECT_CONNECTING;
+        this->_fast_connect_millis = millis();
+        this->_connect_stats.fast_connect_attempted = true;
+        BootTimeline::mark(PSTR("station fast connect"));
+    } else {
+        WiFi.config(0U, 0U, 0U);
+        WiFi.begin(this->_data.ssid, this->_data.passphrase);
+        this->_fast_connect = _CAPTIVE_CONFIG_FAST_CONNECT_NONE;
+        BootTimeline::mark(PSTR("station connect"));
+    }
+}
 
-    inner();
+void CaptiveConfig::_handleGotIP() {
+    if (!this->_connect_stats.got_ip_millis) {
+        this->_connect_stats.got_ip_millis = millis();
+        BootTimeline::mark(PSTR("got ip"));
+    }
 
-    this->_web_server.sendContent(F(
-                "<button id=\"btn\" type=\"submit\">Save</button>"
-            "</form>"
-        "</body>"
-        "</html>"
-    ));
+    if (this->_fast_connect == _CAPTIVE_CONFIG_FAST_CONNECT_CONNECTING) {
+        this->_fast_connect = _CAPTIVE_CONFIG_FAST_CONNECT_CONNECTED;
+        this->_fast_connect_millis = millis();
+        this->_connect_stats.fast_connect_succeeded = true;
+    } else if (this->_fast_connect == _CAPTIVE_CONFIG_FAST_CONNECT_NONE) {
+        // lease has been assigned by DHCP
+        this->_network_cache_dirty = true;
+    }
+}
+
+void CaptiveConfig::_saveNetworkCache() {
+    if (!WiFi.isConnected()) {
+        return;
+    }
+
+    CaptiveConfigNetworkCache cache;
+    memset(&cache, 0, sizeof(cache));
+    strncpy(cache.ssid, this->_data.ssid, sizeof(cache.ssid));
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+    cache.channel = WiFi.channel();
+    cache.ip = WiFi.localIP();
+    cache.gateway = WiFi.gatewayIP();
+    cache.netmask = WiFi.subnetMask();
+    cache.dns[0] = WiFi.dnsIP(0);
+    cache.dns[1] = WiFi.dnsIP(1);
+
+    this->_store.saveNetworkCache(cache);
+    this->_network_cache = cache;
+    this->_network_cache_valid = true;
 }
 
-void CaptiveConfig::_sendFieldset(const char *legend, const std::function<void()> &inner) {
-    String prefix = F(
-        "<fieldset>"
-            "<legend>{l}</legend>"
-    );
+void CaptiveConfig::_applyChanges(const CaptiveConfigData &previous) {
+    bool credentials_changed = strcmp(previous.ssid, this->_data.ssid) || strcmp(previous.passphrase, this->_data.passphrase);
+    bool hostname_changed = strcmp(previous.hostname, this->_data.hostname);
+    bool time_config_changed = strcmp(previous.tz, this->_data.tz)
+        || strcmp(previous.sntp_server[0], this->_data.sntp_server[0])
+        || strcmp(previous.sntp_server[1], this->_data.sntp_server[1])
+        || strcmp(previous.sntp_server[2], this->_data.sntp_server[2]);
 
-    prefix.replace(F("{l}"), legend);
+    if (!this->_data.ssid[0] || !this->_data.passphrase[0]) {
+        // nothing to connect to
+        return;
+    }
+
+    if (this->_config_mode) {
+        // the station is started by _leaveConfigMode, after the soft AP is down
+        return;
+    }
 
-    this->_web_server.sendContent(prefix);
+    if (credentials_changed || !(WiFi.getMode() & WIFI_STA)) {
+        // (re-)join, this also applies the hostname, and the time config when an IP is assigned
+        this->_startStation();
+    } else {
+        if (hostname_changed) {
+            WiFi.hostname(this->_data.hostname);
+        }
+        if (time_config_changed && WiFi.isConnected()) {
+            this->applyTimeConfig();
+        }
+    }
+}
 
-    inner();
+void CaptiveConfig::_leaveConfigMode() {
+    this->_leave_config_mode_pending = false;
 
-    this->_web_server.sendContent(F(
-        "</fieldset>"
-    ));
+    // the web server keeps running for the handlers of the application
+    this->_dns_server.stop();
+    WiFi.softAPdisconnect(true);
+
+    this->_config_mode = false;
+
+    // this also applies the hostname, and the time config when an IP is assigned
+    this->_startStation();
+
+    if (this->_config_mode_left_callback) {
+        this->_config_mode_left_callback();
+    }
 }
 
-void CaptiveConfig::_sendInput(const char *type, const char *label, const char *name, uint16_t max_length, const char *value) {
-    static uint32_t next_id = 0;
-    char id_str[11];
-    snprintf_P(id_str, sizeof(id_str), PSTR("id%x"), next_id++);
+void CaptiveConfig::_sendGzipAsset(PGM_P content_type, const uint8_t *data, size_t len, const char *etag) {
+    this->_web_server.sendHeader(F("ETag"), etag);
+    this->_web_server.sendHeader(F("Cache-Control"), FPSTR(CAPTIVE_CONFIG_ASSET_CACHE_CONTROL));
 
-    char max_length_str[11];
-    snprintf_P(max_length_str, sizeof(max_length_str), PSTR("%u"), max_length);
+    if (this->_web_server.header(F("If-None-Match")) == etag) {
+        this->_web_server.setContentLength(0);
+        this->_web_server.send(304, "text/plain", "");
+        return;
+    }
 
-    String content = F(
-        "<label for=\"{i}\">{l}</label>"
-        "<input type=\"{t}\" id=\"{i}\" name=\"{n}\" maxlength=\"{m}\" value=\"{v}\"/>"
-    );
+    // assets are gzip-compressed at build time (see scripts/gzip_assets.py)
+    this->_web_server.sendHeader(F("Content-Encoding"), F("gzip"));
+    this->_web_server.send_P(200, content_type, reinterpret_cast<PGM_P>(data), len);
+}
+
+void CaptiveConfig::_renderConfigPage(TemplateWriter &writer) {
+    writer.writeTemplate(CAPTIVE_CONFIG_PAGE_HEADER_TEMPLATE);
+
+    this->_renderFieldsetStart(writer, "WiFi");
+    this->_renderInput(writer, "text", "SSID", CAPTIVE_CONFIG_SSID_PARAM_NAME, CAPTIVE_CONFIG_SSID_MAX_LENGTH, this->_data.ssid);
+    this->_renderInput(writer, "password", "Passphrase (empty to keep)", CAPTIVE_CONFIG_PASSPHRASE_PARAM_NAME, CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH, "");
+    this->_renderInput(writer, "text", "Hostname", CAPTIVE_CONFIG_HOSTNAME_PARAM_NAME, CAPTIVE_CONFIG_HOSTNAME_MAX_LENGTH, this->_data.hostname);
+    writer.writeTemplate(CAPTIVE_CONFIG_FIELDSET_END_TEMPLATE);
 
-    content.replace(F("{i}"), id_str);
-    content.replace(F("{l}"), label);
-    content.replace(F("{t}"), type);
-    content.replace(F("{n}"), name);
-    content.replace(F("{m}"), max_length_str);
-    content.replace(F("{v}"), value);
+    this->_renderFieldsetStart(writer, "Time");
+    this->_renderInput(writer, "text", "SNTP Server (primary)", CAPTIVE_CONFIG_SNTP_SERVER_0_PARAM_NAME, CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH, this->_data.sntp_server[0]);
+    this->_renderInput(writer, "text", "SNTP Server (1st fallback)", CAPTIVE_CONFIG_SNTP_SERVER_1_PARAM_NAME, CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH, this->_data.sntp_server[1]);
+    this->_renderInput(writer, "text", "SNTP Server (2nd fallback)", CAPTIVE_CONFIG_SNTP_SERVER_2_PARAM_NAME, CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH, this->_data.sntp_server[2]);
+    this->_renderInput(writer, "text", "TZ", CAPTIVE_CONFIG_TZ_PARAM_NAME, CAPTIVE_CONFIG_TZ_MAX_LENGTH, this->_data.tz);
+    writer.writeTemplate(CAPTIVE_CONFIG_FIELDSET_END_TEMPLATE);
 
-    this->_web_server.sendContent(content);
+    writer.writeTemplate(CAPTIVE_CONFIG_PAGE_FOOTER_TEMPLATE);
 }
 
-void CaptiveConfig::_sendTextInput(const char *label, const char *name, uint16_t max_length, const char *value) {
-    this->_sendInput("text", label, name, max_length, value);
+void CaptiveConfig::_renderFieldsetStart(TemplateWriter &writer, const char *legend) {
+    const char *values[] = { legend };
+    writer.writeTemplate(CAPTIVE_CONFIG_FIELDSET_START_TEMPLATE, values, 1);
 }
 
-void CaptiveConfig::_sendPasswordInput(const char *label, const char *name, uint16_t max_length, const char *value) {
-    this->_sendInput("password", label, name, max_length, value);
+void CaptiveConfig::_renderInput(TemplateWriter &writer, const char *type, const char *label, const char *name, uint16_t max_length, const char *value) {
+    char max_length_str[6];
+    snprintf_P(max_length_str, sizeof(max_length_str), PSTR("%u"), max_length);
+
+    // the name is unique within the page, so it is used as id
+    const char *values[] = { label, type, name, max_length_str, value };
+    writer.writeTemplate(CAPTIVE_CONFIG_INPUT_TEMPLATE, values, 5);
 }
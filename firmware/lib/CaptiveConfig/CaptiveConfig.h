@@ -3,34 +3,55 @@
 
 #include <DNSServer.h>
 #include <ESP8266WebServer.h>
-#include <EEPROM.h>
-
-#define CAPTIVE_CONFIG_SSID_MAX_LENGTH         32
-#define CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH   63
-#define CAPTIVE_CONFIG_HOSTNAME_MAX_LENGTH     24
-#define CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH  63
-#define CAPTIVE_CONFIG_TZ_MAX_LENGTH           63
-
-struct CaptiveConfigData {
-    char ssid[CAPTIVE_CONFIG_SSID_MAX_LENGTH + 1];
-    char passphrase[CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH + 1];
-    char hostname[CAPTIVE_CONFIG_HOSTNAME_MAX_LENGTH + 1];
-    char sntp_server[3][CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH + 1];
-    char tz[CAPTIVE_CONFIG_TZ_MAX_LENGTH + 1];
+
+#include <functional>
+
+#include <CaptiveConfigStore.h>
+#include <TemplateWriter.h>
+
+struct CaptiveConfigConnectStats {
+    // true iff connecting using the network cache (known access point and lease) has been attempted, or has succeeded
+    bool fast_connect_attempted;
+    bool fast_connect_succeeded;
+    // time of the first assigned IP since reset, 0 if none yet
+    unsigned long got_ip_millis;
 };
 
 class CaptiveConfig {
 public:
-    CaptiveConfig(DNSServer &dns_server, ESP8266WebServer &web_server);
+    CaptiveConfig(DNSServer &dns_server, ESP8266WebServer &web_server, CaptiveConfigStore &store);
 
     void begin(const char *ap_ssid, const char *ap_passphrase, bool force_config_mode);
     void doLoop();
 
+    /**
+     * Returns the number of milliseconds until doLoop needs to be called again.
+     */
+    unsigned long getIdleMillis();
+
+    /**
+     * Returns statistics about connecting the station since reset.
+     */
+    const CaptiveConfigConnectStats &getConnectStats();
+
     /**
      * Returns true iff the config mode is currently active.
      */
     bool isConfigMode();
 
+    /**
+     * Applies the configured time zone and SNTP servers.
+     * Must be called whenever the station got an IP.
+     */
+    void applyTimeConfig();
+
+    /**
+     * Sets a callback that is called when config mode has been left after the configuration has been saved.
+     * The station has just been started at that point (config mode only runs the soft AP).
+     * The web server keeps running, only the handlers of the captive portal are disabled.
+     */
+    void onConfigModeLeft(std::function<void()> callback);
+
     /**
      * Checks if the current web request is a captive portal request, i.e. targeted at another host.
      * If it is, responds with a redirect, and returns true. Otherwise, returns false.
@@ -50,8 +71,15 @@ public:
      */
     void handleGetConfigPage();
 
+    /**
+     * Handles a GET request to the stylesheet of the config pages.
+     * Responds with the gzip-compressed stylesheet, or with 304 if the client has a current copy.
+     */
+    void handleGetStyle();
+
     /**
      * Handles a POST request to the config page, i.e. a form submit.
+     * Saves and applies the configuration, and leaves config mode shortly after if a network is configured.
      */
     void handlePostConfigPage();
 
@@ -61,15 +89,39 @@ private:
     DNSServer &_dns_server;
     ESP8266WebServer &_web_server;
 
+    CaptiveConfigStore &_store;
+
     bool _config_mode;
+    bool _leave_config_mode_pending;
+    unsigned long _leave_config_mode_millis;
+    std::function<void()> _config_mode_left_callback;
+
+    WiFiEventHandler _got_ip_handler;
+
+    CaptiveConfigNetworkCache _network_cache;
+    bool _network_cache_valid;
+    bool _network_cache_dirty;
+
+    enum {
+        _CAPTIVE_CONFIG_FAST_CONNECT_NONE,
+        _CAPTIVE_CONFIG_FAST_CONNECT_CONNECTING,
+        _CAPTIVE_CONFIG_FAST_CONNECT_CONNECTED
+    } _fast_connect;
+    unsigned long _fast_connect_millis;
+
+    CaptiveConfigConnectStats _connect_stats;
 
     CaptiveConfigData _data;
 
-    void _sendConfigPageHtml(const std::function<void()> &inner);
-    void _sendFieldset(const char *legend, const std::function<void()> &inner);
-    void _sendInput(const char *type, const char *label, const char *name, uint16_t maxLength, const char *value);
-    void _sendTextInput(const char *label, const char *name, uint16_t max_length, const char *value);
-    void _sendPasswordInput(const char *label, const char *name, uint16_t max_length, const char *value);
+    void _startStation();
+    void _handleGotIP();
+    void _saveNetworkCache();
+    void _applyChanges(const CaptiveConfigData &previous);
+    void _leaveConfigMode();
+    void _sendGzipAsset(PGM_P content_type, const uint8_t *data, size_t len, const char *etag);
+    void _renderConfigPage(TemplateWriter &writer);
+    void _renderFieldsetStart(TemplateWriter &writer, const char *legend);
+    void _renderInput(TemplateWriter &writer, const char *type, const char *label, const char *name, uint16_t max_length, const char *value);
 };
 
 #endif
@@ -0,0 +1,191 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include <string.h>
+
+#include "CaptiveConfigStore.h"
+#include "ConfigJournal.h"
+
+#define CAPTIVE_CONFIG_MAGIC 0x51d3b00b
+
+struct CaptiveConfigPersistentDataHeader {
+    uint32_t magic = 0;
+    uint16_t version = 0;
+} __attribute__((packed));
+
+struct CaptiveConfigDataPersistentV1 {
+    static const uint16_t VERSION = 1;
+
+    CaptiveConfigPersistentDataHeader header;
+    char ssid[CAPTIVE_CONFIG_SSID_MAX_LENGTH + 1];
+    char passphrase[CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH + 1];
+    char sntp_server[3][CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH + 1];
+    char tz[CAPTIVE_CONFIG_TZ_MAX_LENGTH + 1];
+
+    void init() {
+        header.magic = CAPTIVE_CONFIG_MAGIC;
+        header.version = VERSION;
+        ssid[0] = 0;
+        passphrase[0] = 0;
+        strncpy(sntp_server[0], "0.de.pool.ntp.org", sizeof(sntp_server[0]));
+        strncpy(sntp_server[1], "1.de.pool.ntp.org", sizeof(sntp_server[1]));
+        strncpy(sntp_server[2], "2.de.pool.ntp.org", sizeof(sntp_server[2]));
+        strncpy(tz, "CET-1CEST,M3.5.0,M10.5.0/3", sizeof(tz));
+    }
+} __attribute__((packed));
+
+struct CaptiveConfigDataPersistentV2 {
+    static const uint16_t VERSION = 2;
+
+    CaptiveConfigPersistentDataHeader header;
+    char ssid[CAPTIVE_CONFIG_SSID_MAX_LENGTH + 1];
+    char passphrase[CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH + 1];
+    char hostname[CAPTIVE_CONFIG_HOSTNAME_MAX_LENGTH + 1];
+    char sntp_server[3][CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH + 1];
+    char tz[CAPTIVE_CONFIG_TZ_MAX_LENGTH + 1];
+
+    void migrateFrom(const CaptiveConfigDataPersistentV1 &v1) {
+        header.magic = CAPTIVE_CONFIG_MAGIC;
+        header.version = VERSION;
+        strncpy(ssid, v1.ssid, sizeof(ssid));
+        strncpy(passphrase, v1.passphrase, sizeof(passphrase));
+        strncpy(sntp_server[0], v1.sntp_server[0], sizeof(sntp_server[0]));
+        strncpy(sntp_server[1], v1.sntp_server[1], sizeof(sntp_server[1]));
+        strncpy(sntp_server[2], v1.sntp_server[2], sizeof(sntp_server[2]));
+        strncpy(tz, v1.tz, sizeof(tz));
+
+        char newHostname[17];
+        snprintf_P(newHostname, sizeof(newHostname), PSTR("wificlock-%06x"), ESP.getChipId() & 0xFFFFFF);
+        strncpy(hostname, newHostname, sizeof(hostname));
+    }
+} __attribute__((packed));
+
+using CaptiveConfigDataPersistentLatest = CaptiveConfigDataPersistentV2;
+
+CaptiveConfigData createTransientFromPersistent(const CaptiveConfigDataPersistentLatest &persistent) {
+    CaptiveConfigData transient;
+    strncpy(transient.ssid, persistent.ssid, sizeof(transient.ssid));
+    strncpy(transient.passphrase, persistent.passphrase, sizeof(transient.passphrase));
+    strncpy(transient.hostname, persistent.hostname, sizeof(transient.hostname));
+    strncpy(transient.sntp_server[0], persistent.sntp_server[0], sizeof(transient.sntp_server[0]));
+    strncpy(transient.sntp_server[1], persistent.sntp_server[1], sizeof(transient.sntp_server[1]));
+    strncpy(transient.sntp_server[2], persistent.sntp_server[2], sizeof(transient.sntp_server[2]));
+    strncpy(transient.tz, persistent.tz, sizeof(transient.tz));
+    return transient;
+}
+
+CaptiveConfigDataPersistentLatest createPersistentFromTransient(const CaptiveConfigData &transient) {
+    CaptiveConfigDataPersistentLatest persistent;
+    persistent.header.magic = CAPTIVE_CONFIG_MAGIC;
+    persistent.header.version = CaptiveConfigDataPersistentLatest::VERSION;
+    strncpy(persistent.ssid, transient.ssid, sizeof(persistent.ssid));
+    strncpy(persistent.passphrase, transient.passphrase, sizeof(persistent.passphrase));
+    strncpy(persistent.hostname, transient.hostname, sizeof(persistent.hostname));
+    strncpy(persistent.sntp_server[0], transient.sntp_server[0], sizeof(persistent.sntp_server[0]));
+    strncpy(persistent.sntp_server[1], transient.sntp_server[1], sizeof(persistent.sntp_server[1]));
+    strncpy(persistent.sntp_server[2], transient.sntp_server[2], sizeof(persistent.sntp_server[2]));
+    strncpy(persistent.tz, transient.tz, sizeof(persistent.tz));
+    return persistent;
+}
+
+static CaptiveConfigDataPersistentLatest loadFromEeprom() {
+    CaptiveConfigPersistentDataHeader header;
+    EEPROM.begin(sizeof(header));
+    EEPROM.get(0, header);
+    EEPROM.end();
+
+    uint16_t cur_version = 0;
+
+    // initialize or read version 1
+    CaptiveConfigDataPersistentV1 v1;
+    if (header.magic != CAPTIVE_CONFIG_MAGIC) {
+        // initialize config if magic number is not found in EEPROM
+        v1.init();
+        cur_version = CaptiveConfigDataPersistentV1::VERSION;
+    } else if (header.version == CaptiveConfigDataPersistentV1::VERSION) {
+        EEPROM.begin(sizeof(v1));
+        EEPROM.get(0, v1);
+        EEPROM.end();
+        cur_version = CaptiveConfigDataPersistentV1::VERSION;
+    }
+
+    // migrate or read version 2
+    CaptiveConfigDataPersistentV2 v2;
+    if (cur_version == CaptiveConfigDataPersistentV1::VERSION) {
+        v2.migrateFrom(v1);
+        cur_version = CaptiveConfigDataPersistentV2::VERSION;
+    } else if (header.version == CaptiveConfigDataPersistentV2::VERSION) {
+        EEPROM.begin(sizeof(v2));
+        EEPROM.get(0, v2);
+        EEPROM.end();
+        cur_version = CaptiveConfigDataPersistentV2::VERSION;
+    }
+
+    // reset default config if version is not latest after migration
+    if (cur_version != CaptiveConfigDataPersistentLatest::VERSION) {
+        v1.init();
+        v2.migrateFrom(v1);
+    }
+    return v2;
+}
+
+static bool saveToEeprom(const CaptiveConfigDataPersistentLatest &persistent) {
+    EEPROM.begin(sizeof(persistent));
+    EEPROM.put(0, persistent);
+    return EEPROM.end();
+}
+
+CaptiveConfigStore::CaptiveConfigStore(Flash &flash, uint32_t first_sector, uint32_t num_sectors)
+    : _journal_enabled(num_sectors >= CAPTIVE_CONFIG_STORE_TOTAL_SECTORS),
+      _journal(flash, first_sector, CAPTIVE_CONFIG_STORE_SECTORS, sizeof(CaptiveConfigDataPersistentLatest)),
+      _network_cache_journal(flash, first_sector + CAPTIVE_CONFIG_STORE_SECTORS, CAPTIVE_CONFIG_STORE_NETWORK_CACHE_SECTORS, sizeof(CaptiveConfigNetworkCache)) {
+}
+
+bool CaptiveConfigStore::isJournalEnabled() {
+    return _journal_enabled;
+}
+
+CaptiveConfigData CaptiveConfigStore::load() {
+    if (!_journal_enabled) {
+        return createTransientFromPersistent(loadFromEeprom());
+    }
+
+    CaptiveConfigDataPersistentLatest latest;
+    if (!_journal.load(&latest)) {
+        // no journal yet, migrate from EEPROM (or initialize) and start the journal with the result
+        latest = loadFromEeprom();
+        _journal.append(&latest);
+    }
+
+    // convert to transient representation
+    return createTransientFromPersistent(latest);
+}
+
+bool CaptiveConfigStore::save(const CaptiveConfigData &data) {
+    // convert configuration to persistent layout, the journal skips the write if nothing changed
+    CaptiveConfigDataPersistentLatest persistent = createPersistentFromTransient(data);
+    if (!_journal_enabled) {
+        return saveToEeprom(persistent);
+    }
+    return _journal.append(&persistent);
+}
+
+bool CaptiveConfigStore::loadNetworkCache(CaptiveConfigNetworkCache &cache) {
+    return _journal_enabled && _network_cache_journal.load(&cache) && cache.channel != 0;
+}
+
+bool CaptiveConfigStore::saveNetworkCache(const CaptiveConfigNetworkCache &cache) {
+    return _journal_enabled && _network_cache_journal.append(&cache);
+}
+
+ConfigJournalStats CaptiveConfigStore::getStats() {
+    const ConfigJournalStats &config = _journal.getStats();
+    const ConfigJournalStats &network_cache = _network_cache_journal.getStats();
+    return {
+        config.reads + network_cache.reads,
+        config.bytes_read + network_cache.bytes_read,
+        config.writes + network_cache.writes,
+        config.bytes_written + network_cache.bytes_written,
+        config.erases + network_cache.erases
+    };
+}
@@ -0,0 +1,90 @@
+#ifndef _CAPTIVE_CONFIG_STORE_H
+#define _CAPTIVE_CONFIG_STORE_H
+
+#include <inttypes.h>
+
+#include <ConfigJournal.h>
+#include <Flash.h>
+
+#define CAPTIVE_CONFIG_SSID_MAX_LENGTH         32
+#define CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH   63
+#define CAPTIVE_CONFIG_HOSTNAME_MAX_LENGTH     24
+#define CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH  63
+#define CAPTIVE_CONFIG_TZ_MAX_LENGTH           63
+
+// flash sectors used by the journals of the configuration and of the network cache
+#define CAPTIVE_CONFIG_STORE_SECTORS 4
+#define CAPTIVE_CONFIG_STORE_NETWORK_CACHE_SECTORS 2
+#define CAPTIVE_CONFIG_STORE_TOTAL_SECTORS (CAPTIVE_CONFIG_STORE_SECTORS + CAPTIVE_CONFIG_STORE_NETWORK_CACHE_SECTORS)
+
+struct CaptiveConfigData {
+    char ssid[CAPTIVE_CONFIG_SSID_MAX_LENGTH + 1];
+    char passphrase[CAPTIVE_CONFIG_PASSPHRASE_MAX_LENGTH + 1];
+    char hostname[CAPTIVE_CONFIG_HOSTNAME_MAX_LENGTH + 1];
+    char sntp_server[3][CAPTIVE_CONFIG_SNTP_SERVER_MAX_LENGTH + 1];
+    char tz[CAPTIVE_CONFIG_TZ_MAX_LENGTH + 1];
+};
+
+// connection details of the last successful DHCP connection, used to skip scanning and DHCP when reconnecting
+struct CaptiveConfigNetworkCache {
+    // network the cache belongs to
+    char ssid[CAPTIVE_CONFIG_SSID_MAX_LENGTH + 1];
+    uint8_t bssid[6];
+    // 0 if the cache is invalid
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t netmask;
+    uint32_t dns[2];
+} __attribute__((packed));
+
+// persistence of CaptiveConfigData in a journal of flash records, including migration of older layouts from EEPROM
+class CaptiveConfigStore {
+public:
+    /**
+     * Creates a store that uses CAPTIVE_CONFIG_STORE_TOTAL_SECTORS flash sectors starting at first_sector (four for the configuration, two for the network cache).
+     * If num_sectors (the size of the area reserved for the store) is too small, flash is not used at all:
+     * the configuration is stored in EEPROM (like older firmware did), and the network cache is disabled.
+     */
+    CaptiveConfigStore(Flash &flash, uint32_t first_sector, uint32_t num_sectors);
+
+    /**
+     * Returns true iff the journals are used, i.e. if the reserved flash area is large enough.
+     */
+    bool isJournalEnabled();
+
+    /**
+     * Loads the latest configuration from the journal.
+     * If the journal is empty, the configuration is loaded from EEPROM (written by older firmware) and migrated to the latest layout.
+     * Returns the default configuration if EEPROM doesn't contain a valid configuration either.
+     */
+    CaptiveConfigData load();
+
+    /**
+     * Appends the configuration to the journal, using the latest layout.
+     * Nothing is written if the configuration is unchanged. Returns false if writing failed.
+     */
+    bool save(const CaptiveConfigData &data);
+
+    /**
+     * Loads the network cache, returns false if there is none.
+     */
+    bool loadNetworkCache(CaptiveConfigNetworkCache &cache);
+
+    /**
+     * Saves the network cache. Nothing is written if the cache is unchanged. Returns false if writing failed.
+     */
+    bool saveNetworkCache(const CaptiveConfigNetworkCache &cache);
+
+    /**
+     * Returns the flash access counters of both journals (e.g. reads during load, erases during save).
+     */
+    ConfigJournalStats getStats();
+
+private:
+    bool _journal_enabled;
+    ConfigJournal _journal;
+    ConfigJournal _network_cache_journal;
+};
+
+#endif
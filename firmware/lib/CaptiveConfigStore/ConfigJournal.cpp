@@ -0,0 +1,255 @@
+#include <string.h>
+
+#include <ConfigJournal.h>
+
+#define CONFIG_JOURNAL_MAGIC 0xc0f1a55e
+#define CONFIG_JOURNAL_NO_SLOT 0xFFFFFFFF
+
+// size of the aligned buffer used to transfer payloads from and to flash
+#define CONFIG_JOURNAL_CHUNK_SIZE 64
+
+static uint32_t crc32Update(uint32_t crc, const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+        crc ^= bytes[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+static uint32_t crc32(const void *data, size_t size) {
+    return ~crc32Update(0xFFFFFFFF, data, size);
+}
+
+ConfigJournal::ConfigJournal(Flash &flash, uint32_t first_sector, uint8_t num_sectors, size_t payload_size)
+    : _flash(flash), _first_sector(first_sector), _num_sectors(num_sectors), _payload_size(payload_size),
+      _slot_size((sizeof(RecordHeader) + payload_size + 3) & ~3), _slots_per_sector(FLASH_SECTOR_SIZE_BYTES / _slot_size),
+      _scanned(false), _latest_valid(false), _latest_slot(0), _latest_sequence(0), _latest_payload_crc(0), _max_sequence(0), _next_slot(0) {
+    resetStats();
+}
+
+bool ConfigJournal::load(void *payload) {
+    _scan(payload);
+    return _latest_valid;
+}
+
+bool ConfigJournal::append(const void *payload) {
+    if (!_scanned) {
+        _scan(nullptr);
+    }
+
+    uint32_t payload_crc = crc32(payload, _payload_size);
+
+    // skip the write if the latest record already contains this payload
+    if (_latest_valid && payload_crc == _latest_payload_crc) {
+        uint32_t chunk[CONFIG_JOURNAL_CHUNK_SIZE / 4];
+        uint32_t address = _getSlotAddress(_latest_slot) + sizeof(RecordHeader);
+        bool equal = true;
+        for (size_t offset = 0; equal && offset < _payload_size; offset += sizeof(chunk)) {
+            size_t len = _payload_size - offset < sizeof(chunk) ? _payload_size - offset : sizeof(chunk);
+            equal = _read(address + offset, chunk, (len + 3) & ~3) && !memcmp(chunk, static_cast<const uint8_t *>(payload) + offset, len);
+        }
+        if (equal) {
+            return true;
+        }
+    }
+
+    // find the next writable slot, erasing a sector when the log enters it
+    uint32_t num_slots = _num_sectors * _slots_per_sector;
+    uint32_t slot = CONFIG_JOURNAL_NO_SLOT;
+    for (uint32_t i = 0; i < num_slots && slot == CONFIG_JOURNAL_NO_SLOT; i++) {
+        uint32_t candidate = (_next_slot + i) % num_slots;
+        if (candidate % _slots_per_sector == 0) {
+            if (!_flash.eraseSector(_first_sector + candidate / _slots_per_sector)) {
+                return false;
+            }
+            _stats.erases++;
+            slot = candidate;
+        } else {
+            // slots after a torn write may be dirty
+            uint32_t chunk[CONFIG_JOURNAL_CHUNK_SIZE / 4];
+            bool erased = true;
+            for (size_t offset = 0; erased && offset < _slot_size; offset += sizeof(chunk)) {
+                size_t len = _slot_size - offset < sizeof(chunk) ? _slot_size - offset : sizeof(chunk);
+                erased = _read(_getSlotAddress(candidate) + offset, chunk, len);
+                for (size_t j = 0; erased && j < len / 4; j++) {
+                    erased = chunk[j] == 0xFFFFFFFF;
+                }
+            }
+            if (erased) {
+                slot = candidate;
+            }
+        }
+    }
+    if (slot == CONFIG_JOURNAL_NO_SLOT) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.magic = CONFIG_JOURNAL_MAGIC;
+    header.sequence = _max_sequence + 1;
+    header.payload_crc = payload_crc;
+    header.header_crc = crc32(&header, offsetof(RecordHeader, header_crc));
+
+    // header first, so that a torn write never leaves a slot with an erased header and a dirty payload
+    uint32_t address = _getSlotAddress(slot);
+    if (!_write(address, &header, sizeof(header))) {
+        // the slot is tried again (or skipped if it is dirty, or erased again if it starts a sector), so that used slots stay at the start of their sector
+        _next_slot = slot;
+        return false;
+    }
+    _next_slot = (slot + 1) % num_slots;
+    uint32_t chunk[CONFIG_JOURNAL_CHUNK_SIZE / 4];
+    for (size_t offset = 0; offset < _payload_size; offset += sizeof(chunk)) {
+        size_t len = _payload_size - offset < sizeof(chunk) ? _payload_size - offset : sizeof(chunk);
+        memset(chunk, 0xFF, sizeof(chunk));
+        memcpy(chunk, static_cast<const uint8_t *>(payload) + offset, len);
+        if (!_write(address + sizeof(header) + offset, chunk, (len + 3) & ~3)) {
+            return false;
+        }
+    }
+
+    _latest_valid = true;
+    _latest_slot = slot;
+    _latest_sequence = header.sequence;
+    _latest_payload_crc = payload_crc;
+    _max_sequence = header.sequence;
+    return true;
+}
+
+const ConfigJournalStats &ConfigJournal::getStats() {
+    return _stats;
+}
+
+void ConfigJournal::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+uint32_t ConfigJournal::_getSlotAddress(uint32_t slot) {
+    return (_first_sector + slot / _slots_per_sector) * FLASH_SECTOR_SIZE_BYTES + (slot % _slots_per_sector) * _slot_size;
+}
+
+bool ConfigJournal::_read(uint32_t address, void *data, size_t size) {
+    _stats.reads++;
+    _stats.bytes_read += size;
+    return _flash.read(address, static_cast<uint32_t *>(data), size);
+}
+
+bool ConfigJournal::_write(uint32_t address, const void *data, size_t size) {
+    _stats.writes++;
+    _stats.bytes_written += size;
+    return _flash.write(address, static_cast<const uint32_t *>(data), size);
+}
+
+bool ConfigJournal::_readPayload(uint32_t slot, void *payload, uint32_t expected_crc) {
+    uint32_t chunk[CONFIG_JOURNAL_CHUNK_SIZE / 4];
+    uint32_t address = _getSlotAddress(slot) + sizeof(RecordHeader);
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t offset = 0; offset < _payload_size; offset += sizeof(chunk)) {
+        size_t len = _payload_size - offset < sizeof(chunk) ? _payload_size - offset : sizeof(chunk);
+        if (!_read(address + offset, chunk, (len + 3) & ~3)) {
+            return false;
+        }
+        crc = crc32Update(crc, chunk, len);
+        if (payload != nullptr) {
+            memcpy(static_cast<uint8_t *>(payload) + offset, chunk, len);
+        }
+    }
+    return ~crc == expected_crc;
+}
+
+bool ConfigJournal::_readHeader(uint32_t slot, RecordHeader &header, bool &used) {
+    if (!_read(_getSlotAddress(slot), &header, sizeof(header))) {
+        used = true;
+        return false;
+    }
+    const uint32_t *words = reinterpret_cast<const uint32_t *>(&header);
+    used = false;
+    for (size_t i = 0; i < sizeof(header) / 4; i++) {
+        used = used || words[i] != 0xFFFFFFFF;
+    }
+    return header.magic == CONFIG_JOURNAL_MAGIC && header.header_crc == crc32(&header, offsetof(RecordHeader, header_crc));
+}
+
+uint32_t ConfigJournal::_countUsedSlots(uint32_t sector) {
+    // binary search for the first erased slot, the first slot is known to be used
+    uint32_t low = 1;
+    uint32_t high = _slots_per_sector;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        RecordHeader header;
+        bool used;
+        _readHeader(sector * _slots_per_sector + mid, header, used);
+        if (used) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void ConfigJournal::_scan(void *payload) {
+    uint32_t num_slots = _num_sectors * _slots_per_sector;
+
+    _latest_valid = false;
+    _max_sequence = 0;
+    _next_slot = 0;
+
+    // the log is in the sector with the newest first record, so only the first header of each sector is read
+    uint32_t sector = CONFIG_JOURNAL_NO_SLOT;
+    RecordHeader sector_header {};
+    for (uint32_t i = 0; i < _num_sectors; i++) {
+        RecordHeader header;
+        bool used;
+        if (_readHeader(i * _slots_per_sector, header, used) && (sector == CONFIG_JOURNAL_NO_SLOT || header.sequence > sector_header.sequence)) {
+            sector = i;
+            sector_header = header;
+        }
+    }
+    if (sector == CONFIG_JOURNAL_NO_SLOT) {
+        _scanned = true;
+        return;
+    }
+
+    // new records always go after the last used slot, even if its record is torn
+    uint32_t used_slots = _countUsedSlots(sector);
+    _next_slot = (sector * _slots_per_sector + used_slots) % num_slots;
+
+    // try records from newest to oldest until one with an intact payload is found (usually the last one of the sector)
+    bool max_sequence_valid = false;
+    for (uint32_t i = 0; i < _num_sectors && !_latest_valid; i++) {
+        if (i > 0) {
+            // continue with the previous sector of the ring, if it holds older records
+            uint32_t sequence = sector_header.sequence;
+            bool used;
+            sector = (sector + _num_sectors - 1) % _num_sectors;
+            if (!_readHeader(sector * _slots_per_sector, sector_header, used) || sector_header.sequence >= sequence) {
+                break;
+            }
+            used_slots = _countUsedSlots(sector);
+        }
+        for (uint32_t j = used_slots; j-- > 0 && !_latest_valid;) {
+            uint32_t slot = sector * _slots_per_sector + j;
+            RecordHeader header;
+            bool used;
+            if (!_readHeader(slot, header, used)) {
+                continue;
+            }
+            if (!max_sequence_valid) {
+                _max_sequence = header.sequence;
+                max_sequence_valid = true;
+            }
+            if (_readPayload(slot, payload, header.payload_crc)) {
+                _latest_valid = true;
+                _latest_slot = slot;
+                _latest_sequence = header.sequence;
+                _latest_payload_crc = header.payload_crc;
+            }
+        }
+    }
+
+    _scanned = true;
+}
@@ -0,0 +1,74 @@
+#ifndef _CONFIG_JOURNAL_H
+#define _CONFIG_JOURNAL_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <Flash.h>
+
+struct ConfigJournalStats {
+    uint32_t reads;
+    uint32_t bytes_read;
+    uint32_t writes;
+    uint32_t bytes_written;
+    uint32_t erases;
+};
+
+// append-only log of fixed-size records in a ring of flash sectors
+// each record carries a sequence number and CRCs, so torn writes (e.g. power loss) are detected and skipped
+// sectors are only erased when the log wraps into them, which spreads wear across all sectors
+// at least two sectors are required, so that the latest record survives erasing the next sector
+// sectors are filled from their start, so loading reads the first header of each sector, finds the end of the newest sector by binary search,
+// and then reads the last record (older records are only read if its payload is torn)
+class ConfigJournal {
+public:
+    ConfigJournal(Flash &flash, uint32_t first_sector, uint8_t num_sectors, size_t payload_size);
+
+    // loads the payload of the latest valid record, returns false if there is none
+    bool load(void *payload);
+
+    // appends a record unless its payload equals the latest valid record, returns false if writing failed
+    bool append(const void *payload);
+
+    const ConfigJournalStats &getStats();
+    void resetStats();
+
+private:
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t payload_crc;
+        uint32_t header_crc;
+    };
+
+    Flash &_flash;
+    uint32_t _first_sector;
+    uint8_t _num_sectors;
+    size_t _payload_size;
+    size_t _slot_size;
+    size_t _slots_per_sector;
+
+    // result of the last scan
+    bool _scanned;
+    bool _latest_valid;
+    uint32_t _latest_slot;
+    uint32_t _latest_sequence;
+    uint32_t _latest_payload_crc;
+    // highest sequence number of any record with an intact header
+    uint32_t _max_sequence;
+    uint32_t _next_slot;
+
+    ConfigJournalStats _stats;
+
+    uint32_t _getSlotAddress(uint32_t slot);
+    bool _read(uint32_t address, void *data, size_t size);
+    bool _write(uint32_t address, const void *data, size_t size);
+    // reads the header of the slot, returns true iff it is intact, used is false iff the header is erased
+    bool _readHeader(uint32_t slot, RecordHeader &header, bool &used);
+    // returns the number of used slots at the start of the sector (index in the ring), whose first slot must be used
+    uint32_t _countUsedSlots(uint32_t sector);
+    bool _readPayload(uint32_t slot, void *payload, uint32_t expected_crc);
+    void _scan(void *payload);
+};
+
+#endif
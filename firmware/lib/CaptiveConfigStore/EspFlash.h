@@ -0,0 +1,36 @@
+#ifndef _ESP_FLASH_H
+#define _ESP_FLASH_H
+
+#include <Arduino.h>
+#include <flash_hal.h>
+
+#include <Flash.h>
+
+// flash of the ESP8266 (header-only, because it is not available in native builds)
+class EspFlash : public Flash {
+public:
+    virtual bool read(uint32_t address, uint32_t *data, size_t size) override {
+        return ESP.flashRead(address, data, size);
+    }
+
+    virtual bool write(uint32_t address, const uint32_t *data, size_t size) override {
+        return ESP.flashWrite(address, data, size);
+    }
+
+    virtual bool eraseSector(uint32_t sector) override {
+        return ESP.flashEraseSector(sector);
+    }
+
+    // returns the first sector of the filesystem area, which is not used by this firmware
+    // the area is empty (address and size 0) if the board is built without a filesystem, so always check getFsSectorCount
+    static uint32_t getFsStartSector() {
+        return (FS_PHYS_ADDR) / FLASH_SECTOR_SIZE_BYTES;
+    }
+
+    // returns the number of sectors of the filesystem area
+    static uint32_t getFsSectorCount() {
+        return (FS_PHYS_SIZE) / FLASH_SECTOR_SIZE_BYTES;
+    }
+};
+
+#endif
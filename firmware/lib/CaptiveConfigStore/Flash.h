@@ -0,0 +1,21 @@
+#ifndef _FLASH_H
+#define _FLASH_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#define FLASH_SECTOR_SIZE_BYTES 4096
+
+// NOR flash, i.e. erasing sets all bits of a sector, writing can only clear bits
+// addresses and sizes of reads and writes must be multiples of 4, data must be 4-byte aligned
+class Flash {
+public:
+    virtual bool read(uint32_t address, uint32_t *data, size_t size) = 0;
+    virtual bool write(uint32_t address, const uint32_t *data, size_t size) = 0;
+    virtual bool eraseSector(uint32_t sector) = 0;
+
+protected:
+    virtual ~Flash() = default; // prevent delete on pointers to this type
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include <string.h>
+
+#include <SimulatedFlash.h>
+
+SimulatedFlash::SimulatedFlash() : _power_loss(false), _bytes_until_power_loss(0) {
+    memset(_data, 0xFF, sizeof(_data));
+    resetCounters();
+}
+
+bool SimulatedFlash::read(uint32_t address, uint32_t *data, size_t size) {
+    if ((address & 3) || (size & 3) || address + size > sizeof(_data)) {
+        return false;
+    }
+    _read_count++;
+    _bytes_read += size;
+    memcpy(data, _data + address, size);
+    return true;
+}
+
+bool SimulatedFlash::write(uint32_t address, const uint32_t *data, size_t size) {
+    if ((address & 3) || (size & 3) || address + size > sizeof(_data)) {
+        return false;
+    }
+    _write_count++;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+        if (_power_loss) {
+            return false;
+        }
+        // NOR flash can only clear bits
+        _data[address + i] &= bytes[i];
+        _bytes_written++;
+        if (_bytes_until_power_loss > 0 && --_bytes_until_power_loss == 0) {
+            _power_loss = true;
+        }
+    }
+    return true;
+}
+
+bool SimulatedFlash::eraseSector(uint32_t sector) {
+    if (_power_loss || sector >= SIMULATED_FLASH_SECTORS) {
+        return false;
+    }
+    _erase_count++;
+    memset(_data + sector * FLASH_SECTOR_SIZE_BYTES, 0xFF, FLASH_SECTOR_SIZE_BYTES);
+    return true;
+}
+
+void SimulatedFlash::failAfterBytesWritten(size_t bytes) {
+    _power_loss = bytes == 0;
+    _bytes_until_power_loss = bytes;
+}
+
+void SimulatedFlash::restorePower() {
+    _power_loss = false;
+    _bytes_until_power_loss = 0;
+}
+
+uint32_t SimulatedFlash::getReadCount() const {
+    return _read_count;
+}
+
+uint32_t SimulatedFlash::getBytesRead() const {
+    return _bytes_read;
+}
+
+uint32_t SimulatedFlash::getWriteCount() const {
+    return _write_count;
+}
+
+uint32_t SimulatedFlash::getBytesWritten() const {
+    return _bytes_written;
+}
+
+uint32_t SimulatedFlash::getEraseCount() const {
+    return _erase_count;
+}
+
+void SimulatedFlash::resetCounters() {
+    _read_count = 0;
+    _bytes_read = 0;
+    _write_count = 0;
+    _bytes_written = 0;
+    _erase_count = 0;
+}
@@ -0,0 +1,42 @@
+#ifndef _SIMULATED_FLASH_H
+#define _SIMULATED_FLASH_H
+
+#include <Flash.h>
+
+#define SIMULATED_FLASH_SECTORS 8
+
+// RAM-backed NOR flash for native builds, with counters and simulated power loss
+class SimulatedFlash : public Flash {
+public:
+    SimulatedFlash();
+
+    virtual bool read(uint32_t address, uint32_t *data, size_t size) override;
+    virtual bool write(uint32_t address, const uint32_t *data, size_t size) override;
+    virtual bool eraseSector(uint32_t sector) override;
+
+    // simulates a power loss after the given number of bytes have been written, i.e. all later writes and erases fail
+    void failAfterBytesWritten(size_t bytes);
+    // restores power
+    void restorePower();
+
+    uint32_t getReadCount() const;
+    uint32_t getBytesRead() const;
+    uint32_t getWriteCount() const;
+    uint32_t getBytesWritten() const;
+    uint32_t getEraseCount() const;
+    void resetCounters();
+
+private:
+    uint8_t _data[SIMULATED_FLASH_SECTORS * FLASH_SECTOR_SIZE_BYTES];
+
+    bool _power_loss;
+    size_t _bytes_until_power_loss;
+
+    uint32_t _read_count;
+    uint32_t _bytes_read;
+    uint32_t _write_count;
+    uint32_t _bytes_written;
+    uint32_t _erase_count;
+};
+
+#endif
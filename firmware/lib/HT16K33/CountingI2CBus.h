@@ -0,0 +1,71 @@
+#ifndef _COUNTING_I2C_BUS_H
+#define _COUNTING_I2C_BUS_H
+
+#include <I2CBus.h>
+
+// I2C bus that counts the transactions, bytes and failed transactions (not acknowledged, or short reads) of another bus
+class CountingI2CBus : public I2CBus {
+public:
+    CountingI2CBus(I2CBus &bus) : _bus(bus), _transactions(0), _bytes(0), _errors(0) {
+    }
+
+    virtual bool write(uint8_t addr, const uint8_t *data, size_t num) override {
+        bool success = _bus.write(addr, data, num);
+        _transactions++;
+        _bytes += num;
+        if (!success) {
+            _errors++;
+        }
+        return success;
+    }
+
+    virtual size_t read(uint8_t addr, uint8_t *data, size_t num) override {
+        size_t actual_num = _bus.read(addr, data, num);
+        _transactions++;
+        _bytes += actual_num;
+        if (actual_num != num) {
+            _errors++;
+        }
+        return actual_num;
+    }
+
+    virtual size_t writeRead(uint8_t addr, const uint8_t *write_data, size_t write_num, uint8_t *read_data, size_t read_num) override {
+        // forwarded as a whole, so that a retrying bus can retry both transactions
+        size_t actual_num = _bus.writeRead(addr, write_data, write_num, read_data, read_num);
+        // nothing is read if the write has not been acknowledged, count the read only if it has been attempted
+        _transactions += actual_num > 0 ? 2 : 1;
+        _bytes += write_num + actual_num;
+        if (actual_num != read_num) {
+            _errors++;
+        }
+        return actual_num;
+    }
+
+    virtual void setClock(uint32_t frequency) override {
+        _bus.setClock(frequency);
+    }
+
+    virtual bool recover() override {
+        return _bus.recover();
+    }
+
+    uint32_t getTransactions() {
+        return _transactions;
+    }
+
+    uint32_t getBytes() {
+        return _bytes;
+    }
+
+    uint32_t getErrors() {
+        return _errors;
+    }
+
+private:
+    I2CBus &_bus;
+    uint32_t _transactions;
+    uint32_t _bytes;
+    uint32_t _errors;
+};
+
+#endif
@@ -1,44 +1,47 @@
 #include <Arduino.h>
 
+#include <BootTimeline.h>
 #include <HT16K33.h>
-#include <Wire.h>
+#include <I2CBus.h>
 
-HT16K33::HT16K33(uint8_t addr)
-    : _addr(addr), _led_mem { 0, 0, 0, 0, 0, 0, 0, 0 }, _led_next_mem { 0, 0, 0, 0, 0, 0, 0, 0 }, _key_mem { 0, 0, 0 } {
+// key scanning takes 9.504ms per cycle (datasheet, page 30), so waiting for two cycles makes sure that it has been performed since the last read
+#define HT16K33_KEY_SCAN_INTERVAL_MILLIS 20
+
+HT16K33::HT16K33(I2CBus &bus, uint8_t addr)
+    : _bus(bus), _addr(addr), _led_mem { 0, 0, 0, 0, 0, 0, 0, 0 }, _led_next_mem { 0, 0, 0, 0, 0, 0, 0, 0 }, _led_mem_valid(false), _key_mem { 0, 0, 0 }, _last_key_scan_millis(0),
+      _led_stats { 0, 0, 0, 0, 0 },
+      _system_setup(0), _display_setup(0), _dimming(0), _registers_dirty(false) {
 }
 
-static void i2c_write(uint8_t addr, uint8_t data) {
-    Wire.beginTransmission(addr);
-    Wire.write(data);
-    Wire.endTransmission();
+static bool i2c_write(I2CBus &bus, uint8_t addr, uint8_t data) {
+    return bus.write(addr, &data, 1);
 }
 
-static void i2c_write(uint8_t addr, uint8_t *data, size_t num) {
-    Wire.beginTransmission(addr);
-    for (size_t i = 0; i < num; i++) {
-        Wire.write(data[i]);
-    }
-    Wire.endTransmission();
+static bool i2c_write(I2CBus &bus, uint8_t addr, const uint8_t *data, size_t num) {
+    return bus.write(addr, data, num);
 }
 
-static size_t i2c_read(uint8_t addr, uint8_t *data, size_t num) {
-    size_t actual_num = Wire.requestFrom(addr, num, true);
-    for (size_t i = 0; i < actual_num; i++) {
-        data[i] = Wire.read();
-    }
-    return actual_num;
+static bool i2c_write_read(I2CBus &bus, uint8_t addr, uint8_t command, uint8_t *data, size_t num) {
+    return bus.writeRead(addr, &command, 1, data, num) == num;
 }
 
 void HT16K33::begin() {
     // datasheet, page 8: "Data transfers on the I2C-bus should be avoided for 1 ms following a power-on to allow completion of the reset action."
     delay(1);
 
+    // register contents are unknown (0 is not a valid value for any of them), so all of the following commands are sent
+    _system_setup = 0;
+    _display_setup = 0;
+    _dimming = 0;
+    _registers_dirty = false;
+
     // turn off oscillator (standby mode)
     // this resets key data in case that HT16K33 was not powered down before (e.g. software or hardware reset)
-    i2c_write(_addr, 0x20);
+    _writeCommand(_system_setup, 0x20);
 
-    // turn on oscillator
-    i2c_write(_addr, 0x21);
+    // turn on oscillator (this starts key scanning)
+    _writeCommand(_system_setup, 0x21);
+    _last_key_scan_millis = millis();
 
     // set full brightness
     setBrightness(15);
@@ -48,46 +51,110 @@ void HT16K33::begin() {
         setLedColumn(column, 0);
     }
     updateLeds(true);
+    BootTimeline::mark(PSTR("ht16k33 init"));
 
-    // initialize key memory
+    // initialize key memory (blocking, because callers expect valid key data after begin)
+    delay(HT16K33_KEY_SCAN_INTERVAL_MILLIS);
     updateKeys();
     
     // turn on display, disable blinking
-    i2c_write(_addr, 0x81);
+    _writeCommand(_display_setup, 0x81);
+    BootTimeline::mark(PSTR("ht16k33 keys"));
 }
 
 void HT16K33::setBrightness(uint8_t brightness) {
-    i2c_write(_addr, 0xE0 | (brightness & 0x0F));
+    _writeCommand(_dimming, 0xE0 | (brightness & 0x0F));
+}
+
+void HT16K33::setBlinkRate(HT16K33BlinkRate blink_rate) {
+    _writeCommand(_display_setup, 0x80 | ((blink_rate & 0x03) << 1) | (_display_setup & 0x01));
+}
+
+void HT16K33::setDisplayOn(bool display_on) {
+    _writeCommand(_display_setup, 0x80 | (_display_setup & 0x06) | (display_on ? 0x01 : 0x00));
 }
 
 void HT16K33::updateLeds(bool force) {
-    // update LEDs
-    if (force || memcmp(_led_mem, _led_next_mem, sizeof(_led_mem))) {
-        memcpy(_led_mem, _led_next_mem, sizeof(_led_mem));
+    if (_registers_dirty) {
+        _rewriteRegisters();
+    }
+
+    // display RAM byte layout (low byte of column 0, high byte of column 0, low byte of column 1, ...)
+    uint8_t ram[16];
+    for (uint8_t i = 0; i < 8; i++) {
+        ram[2 * i] = _led_next_mem[i] & 0xFF;
+        ram[2 * i + 1] = _led_next_mem[i] >> 8;
+    }
 
-        uint8_t tmp[17];
-        size_t num = 0;
-        tmp[num++] = 0x00;
+    // find the smallest window of changed display RAM addresses
+    uint8_t first = 0;
+    uint8_t last = 15;
+    if (!force && _led_mem_valid) {
+        uint8_t old_ram[16];
         for (uint8_t i = 0; i < 8; i++) {
-            tmp[num++] = _led_mem[i] & 0xFF;
-            tmp[num++] = _led_mem[i] >> 8;
+            old_ram[2 * i] = _led_mem[i] & 0xFF;
+            old_ram[2 * i + 1] = _led_mem[i] >> 8;
+        }
+        while (first < 16 && ram[first] == old_ram[first]) {
+            first++;
         }
+        if (first == 16) {
+            // nothing changed
+            _led_stats.transactions_saved++;
+            _led_stats.bytes_saved += 17;
+            return;
+        }
+        while (ram[last] == old_ram[last]) {
+            last--;
+        }
+    }
 
-        i2c_write(_addr, tmp, num);
+    // write the window only, the address pointer is auto-incremented by HT16K33
+    uint8_t tmp[17];
+    size_t num = 0;
+    tmp[num++] = first;
+    for (uint8_t i = first; i <= last; i++) {
+        tmp[num++] = ram[i];
+    }
+
+    _led_stats.transactions++;
+    _led_stats.bytes += num;
+    _led_stats.bytes_saved += 17 - num;
+
+    if (i2c_write(_bus, _addr, tmp, num)) {
+        memcpy(_led_mem, _led_next_mem, sizeof(_led_mem));
+        _led_mem_valid = true;
+    } else {
+        // part of the data may have been written, so the next update writes all of it
+        _led_mem_valid = false;
+        _led_stats.failures++;
     }
 }
 
-void HT16K33::updateKeys() {
-    // wait for at least two cycles (2 * 9.504ms) to make sure key scanning hast been performed since the last read
-    delay(20);
+bool HT16K33::updateKeys() {
+    // only read key memory if key scanning has been performed since the last read
+    unsigned long cur_millis = millis();
+    if (cur_millis - _last_key_scan_millis < HT16K33_KEY_SCAN_INTERVAL_MILLIS) {
+        return false;
+    }
+    _last_key_scan_millis = cur_millis;
 
-    i2c_write(_addr, 0x40);
-    uint8_t tmp[6] = { 0, 0, 0, 0, 0, 0 };
-    i2c_read(_addr, tmp, 6);
+    uint8_t tmp[6];
+    if (!i2c_write_read(_bus, _addr, 0x40, tmp, 6)) {
+        // keep the previous key state instead of reporting keys that are not pressed
+        return false;
+    }
 
     for (int i = 0; i < 3; i++) {
         _key_mem[i] = (tmp[2 * i + 1] << 8) | tmp[2 * i];
     }
+
+    return true;
+}
+
+unsigned long HT16K33::getKeyScanDelay() {
+    unsigned long elapsed_millis = millis() - _last_key_scan_millis;
+    return elapsed_millis >= HT16K33_KEY_SCAN_INTERVAL_MILLIS ? 0 : HT16K33_KEY_SCAN_INTERVAL_MILLIS - elapsed_millis;
 }
 
 void HT16K33::setLedColumn(uint8_t column, uint16_t row_bits) {
@@ -101,3 +168,22 @@ void HT16K33::clearAllLedColumns() {
 uint16_t HT16K33::getKeyColumn(uint8_t column) {
     return _key_mem[column];
 }
+
+const HT16K33LedStats &HT16K33::getLedStats() {
+    return _led_stats;
+}
+
+void HT16K33::_writeCommand(uint8_t &shadow, uint8_t command) {
+    // drop redundant writes, the register already contains the value
+    if (shadow != command) {
+        shadow = command;
+        if (!i2c_write(_bus, _addr, command)) {
+            // sent again by the next LED update
+            _registers_dirty = true;
+        }
+    }
+}
+
+void HT16K33::_rewriteRegisters() {
+    _registers_dirty = !(i2c_write(_bus, _addr, _system_setup) && i2c_write(_bus, _addr, _dimming) && i2c_write(_bus, _addr, _display_setup));
+}
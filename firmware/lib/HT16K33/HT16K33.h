@@ -1,19 +1,46 @@
 #ifndef _HT16K33_H
 #define _HT16K33_H
 
-#include <Wire.h>
+#include <inttypes.h>
+
+#include <I2CBus.h>
+
+// LED update statistics, relative to writing the complete display RAM (17 bytes including the address) on every update
+struct HT16K33LedStats {
+    // number of LED write transactions and bytes actually sent
+    uint32_t transactions;
+    uint32_t bytes;
+    // number of LED write transactions skipped because nothing changed, and bytes not sent because of partial or skipped writes
+    uint32_t transactions_saved;
+    uint32_t bytes_saved;
+    // number of LED write transactions that failed (the next update writes all LED memory then)
+    uint32_t failures;
+};
+
+enum HT16K33BlinkRate : uint8_t {
+    HT16K33_BLINK_OFF = 0,
+    HT16K33_BLINK_2HZ = 1,
+    HT16K33_BLINK_1HZ = 2,
+    HT16K33_BLINK_0_5HZ = 3
+};
 
 class HT16K33 {
 public:
-    HT16K33(uint8_t addr = 0x70);
+    HT16K33(I2CBus &bus, uint8_t addr = 0x70);
 
     void begin();
 
+    // command register setters, writes are skipped if the register already contains the value
     void setBrightness(uint8_t brightness);
+    void setBlinkRate(HT16K33BlinkRate blink_rate);
+    void setDisplayOn(bool display_on);
 
-    // updates key memory from HT16K33
-    void updateKeys();
-    // writes LED memory to HT16K33
+    // updates key memory from HT16K33 if key scanning has been performed since the last update
+    // returns immediately if not, returns true iff key memory has been updated
+    bool updateKeys();
+    // returns the number of milliseconds until updateKeys will read key memory again
+    unsigned long getKeyScanDelay();
+    // writes changed LED memory to HT16K33, or all LED memory if force is true or the previous write failed
     void updateLeds(bool force = false);
 
     void setLedColumn(uint8_t column, uint16_t row_bits);
@@ -21,12 +48,30 @@ public:
 
     uint16_t getKeyColumn(uint8_t column);
 
+    const HT16K33LedStats &getLedStats();
+
 private:
+    I2CBus &_bus;
     uint8_t _addr;
     uint16_t _led_mem[8];
     uint16_t _led_next_mem[8];
+    // false if the contents of the display RAM are unknown
+    bool _led_mem_valid;
 
     uint16_t _key_mem[3];
+    unsigned long _last_key_scan_millis;
+
+    HT16K33LedStats _led_stats;
+
+    // shadow copies of the command registers
+    uint8_t _system_setup;
+    uint8_t _display_setup;
+    uint8_t _dimming;
+    // true if a command has not been acknowledged, all command registers are written again then
+    bool _registers_dirty;
+
+    void _writeCommand(uint8_t &shadow, uint8_t command);
+    void _rewriteRegisters();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef _I2C_BUS_H
+#define _I2C_BUS_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+class I2CBus {
+public:
+    // writes num bytes to the device at addr in a single transaction
+    // returns true iff the transaction has been acknowledged
+    virtual bool write(uint8_t addr, const uint8_t *data, size_t num) = 0;
+
+    // reads up to num bytes from the device at addr in a single transaction
+    // returns the number of bytes actually read
+    virtual size_t read(uint8_t addr, uint8_t *data, size_t num) = 0;
+
+    // writes write_num bytes (e.g. an address pointer) and reads up to read_num bytes from the device at addr
+    // returns the number of bytes actually read (0 if the write has not been acknowledged)
+    // buses that can retry must retry both, because reading advances the address pointer of the device
+    virtual size_t writeRead(uint8_t addr, const uint8_t *write_data, size_t write_num, uint8_t *read_data, size_t read_num) {
+        return write(addr, write_data, write_num) ? read(addr, read_data, read_num) : 0;
+    }
+
+    // sets the SCL frequency in Hz, if supported by the bus
+    virtual void setClock(uint32_t frequency) {
+    }
+
+    // frees the bus if a device holds SDA low (e.g. after an interrupted transaction)
+    // returns true iff the bus is idle afterwards
+    virtual bool recover() {
+        return true;
+    }
+
+protected:
+    virtual ~I2CBus() = default; // prevent delete on pointers to this type
+};
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef _RETRYING_I2C_BUS_H
+#define _RETRYING_I2C_BUS_H
+
+#include <Arduino.h>
+
+#include <I2CBus.h>
+
+// number of retries after a failed transaction, the bus is recovered before each retry
+#define RETRYING_I2C_BUS_RETRIES 3
+
+// number of consecutive failed attempts in fast mode after which the bus falls back to standard mode
+#define RETRYING_I2C_BUS_FALLBACK_ERRORS 3
+
+// time after a fallback until fast mode is tried again
+#define RETRYING_I2C_BUS_FAST_MODE_RETRY_MILLIS 60000
+
+#define RETRYING_I2C_BUS_FAST_MODE_CLOCK 400000
+#define RETRYING_I2C_BUS_STANDARD_MODE_CLOCK 100000
+
+// I2C bus that retries failed transactions (not acknowledged, or short reads) of another bus
+// in fast mode, a series of failures switches the bus to standard mode, and fast mode is tried again some time later
+class RetryingI2CBus : public I2CBus {
+public:
+    RetryingI2CBus(I2CBus &bus)
+        : _bus(bus), _fast_mode_enabled(false), _fast_mode(false), _consecutive_errors(0), _fallback_millis(0), _errors(0), _retries(0), _failures(0),
+          _recoveries(0), _fallbacks(0) {
+    }
+
+    // sets the clock of the bus, 400 kHz in fast mode and 100 kHz otherwise
+    void begin(bool fast_mode) {
+        _fast_mode_enabled = fast_mode;
+        _consecutive_errors = 0;
+        _setFastMode(fast_mode);
+    }
+
+    virtual bool write(uint8_t addr, const uint8_t *data, size_t num) override {
+        _beginTransaction();
+        for (uint8_t attempt = 0;; attempt++) {
+            if (_bus.write(addr, data, num)) {
+                _consecutive_errors = 0;
+                return true;
+            }
+            if (!_handleError(attempt)) {
+                return false;
+            }
+        }
+    }
+
+    virtual size_t read(uint8_t addr, uint8_t *data, size_t num) override {
+        _beginTransaction();
+        for (uint8_t attempt = 0;; attempt++) {
+            size_t actual_num = _bus.read(addr, data, num);
+            if (actual_num == num) {
+                _consecutive_errors = 0;
+                return actual_num;
+            }
+            if (!_handleError(attempt)) {
+                return actual_num;
+            }
+        }
+    }
+
+    virtual size_t writeRead(uint8_t addr, const uint8_t *write_data, size_t write_num, uint8_t *read_data, size_t read_num) override {
+        _beginTransaction();
+        for (uint8_t attempt = 0;; attempt++) {
+            size_t actual_num = _bus.writeRead(addr, write_data, write_num, read_data, read_num);
+            if (actual_num == read_num) {
+                _consecutive_errors = 0;
+                return actual_num;
+            }
+            if (!_handleError(attempt)) {
+                return actual_num;
+            }
+        }
+    }
+
+    virtual void setClock(uint32_t frequency) override {
+        _bus.setClock(frequency);
+    }
+
+    virtual bool recover() override {
+        _recoveries++;
+        return _bus.recover();
+    }
+
+    bool isFastMode() {
+        return _fast_mode;
+    }
+
+    // returns the number of failed attempts, including those that succeeded on retry
+    uint32_t getErrors() {
+        return _errors;
+    }
+
+    uint32_t getRetries() {
+        return _retries;
+    }
+
+    // returns the number of transactions that failed even after all retries
+    uint32_t getFailures() {
+        return _failures;
+    }
+
+    // returns the number of bus recovery attempts (one before each retry)
+    uint32_t getRecoveries() {
+        return _recoveries;
+    }
+
+    // returns the number of switches from fast mode to standard mode
+    uint32_t getFallbacks() {
+        return _fallbacks;
+    }
+
+private:
+    I2CBus &_bus;
+    // fast mode has been requested by begin
+    bool _fast_mode_enabled;
+    bool _fast_mode;
+    uint8_t _consecutive_errors;
+    unsigned long _fallback_millis;
+    uint32_t _errors;
+    uint32_t _retries;
+    uint32_t _failures;
+    uint32_t _recoveries;
+    uint32_t _fallbacks;
+
+    void _setFastMode(bool fast_mode) {
+        _fast_mode = fast_mode;
+        _bus.setClock(fast_mode ? RETRYING_I2C_BUS_FAST_MODE_CLOCK : RETRYING_I2C_BUS_STANDARD_MODE_CLOCK);
+    }
+
+    void _beginTransaction() {
+        // the errors may have been caused by a transient disturbance, so try fast mode again after a while
+        if (_fast_mode_enabled && !_fast_mode && millis() - _fallback_millis >= RETRYING_I2C_BUS_FAST_MODE_RETRY_MILLIS) {
+            _consecutive_errors = 0;
+            _setFastMode(true);
+        }
+    }
+
+    // returns true iff the transaction should be retried
+    bool _handleError(uint8_t attempt) {
+        _errors++;
+        // single errors are retried in fast mode, only a series of them indicates that the bus is too slow (e.g. long wires)
+        if (_consecutive_errors < RETRYING_I2C_BUS_FALLBACK_ERRORS) {
+            _consecutive_errors++;
+        }
+        if (_fast_mode && _consecutive_errors >= RETRYING_I2C_BUS_FALLBACK_ERRORS) {
+            _fallbacks++;
+            _fallback_millis = millis();
+            _setFastMode(false);
+        }
+        if (attempt == RETRYING_I2C_BUS_RETRIES) {
+            _failures++;
+            return false;
+        }
+        // a device may still hold SDA low after an interrupted transaction
+        recover();
+        _retries++;
+        return true;
+    }
+};
+
+#endif
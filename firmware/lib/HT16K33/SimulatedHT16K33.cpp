@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include <SimulatedHT16K33.h>
+
+SimulatedHT16K33::SimulatedHT16K33(uint8_t addr)
+    : _addr(addr), _display_ram { 0 }, _key_state { 0, 0, 0 }, _system_setup(0x20), _display_setup(0x80), _dimming(0xEF), _pointer(0x00), _nacks(0), _short_reads(0),
+      _bus_stuck(false) {
+    resetCounters();
+}
+
+bool SimulatedHT16K33::write(uint8_t addr, const uint8_t *data, size_t num) {
+    if (addr != _addr || _bus_stuck) {
+        // no device at this address (or no start condition possible), i.e. NACK
+        return false;
+    }
+
+    if (_nacks) {
+        _nacks--;
+        // the device has received part of the data
+        _applyWrite(data, num / 2);
+        return false;
+    }
+
+    _applyWrite(data, num);
+    return true;
+}
+
+size_t SimulatedHT16K33::read(uint8_t addr, uint8_t *data, size_t num) {
+    if (addr != _addr || _bus_stuck) {
+        return 0;
+    }
+
+    if (_short_reads) {
+        _short_reads--;
+        num /= 2;
+    }
+
+    _read_transaction_count++;
+    _read_byte_count += num;
+
+    for (size_t i = 0; i < num; i++) {
+        data[i] = _readByte(_pointer);
+        if (_pointer < 0x10) {
+            _pointer = (_pointer + 1) & 0x0F;
+        } else if (_pointer >= 0x40 && _pointer < 0x45) {
+            _pointer++;
+        }
+    }
+
+    return num;
+}
+
+bool SimulatedHT16K33::recover() {
+    _bus_stuck = false;
+    return true;
+}
+
+void SimulatedHT16K33::injectNacks(uint32_t num) {
+    _nacks = num;
+}
+
+void SimulatedHT16K33::injectShortReads(uint32_t num) {
+    _short_reads = num;
+}
+
+void SimulatedHT16K33::setBusStuck(bool stuck) {
+    _bus_stuck = stuck;
+}
+
+void SimulatedHT16K33::setKeyColumn(uint8_t column, uint16_t row_bits) {
+    // 13 rows per key column
+    _key_state[column] = row_bits & 0x1FFF;
+}
+
+uint16_t SimulatedHT16K33::getLedColumn(uint8_t column) const {
+    return (_display_ram[2 * column + 1] << 8) | _display_ram[2 * column];
+}
+
+bool SimulatedHT16K33::isOscillatorOn() const {
+    return _system_setup & 0x01;
+}
+
+bool SimulatedHT16K33::isDisplayOn() const {
+    return _display_setup & 0x01;
+}
+
+uint8_t SimulatedHT16K33::getBlinkRate() const {
+    return (_display_setup >> 1) & 0x03;
+}
+
+uint8_t SimulatedHT16K33::getBrightness() const {
+    return _dimming & 0x0F;
+}
+
+uint32_t SimulatedHT16K33::getWriteTransactionCount() const {
+    return _write_transaction_count;
+}
+
+uint32_t SimulatedHT16K33::getReadTransactionCount() const {
+    return _read_transaction_count;
+}
+
+uint32_t SimulatedHT16K33::getWrittenByteCount() const {
+    return _written_byte_count;
+}
+
+uint32_t SimulatedHT16K33::getReadByteCount() const {
+    return _read_byte_count;
+}
+
+void SimulatedHT16K33::resetCounters() {
+    _write_transaction_count = 0;
+    _read_transaction_count = 0;
+    _written_byte_count = 0;
+    _read_byte_count = 0;
+}
+
+void SimulatedHT16K33::_applyWrite(const uint8_t *data, size_t num) {
+    _write_transaction_count++;
+    _written_byte_count += num;
+
+    if (num == 0) {
+        return;
+    }
+
+    uint8_t command = data[0];
+    switch (command & 0xF0) {
+    case 0x00:
+        // display data address pointer, followed by display data with auto-increment
+        _pointer = command;
+        for (size_t i = 1; i < num; i++) {
+            _display_ram[_pointer] = data[i];
+            _pointer = (_pointer + 1) & 0x0F;
+        }
+        break;
+    case 0x20:
+        _system_setup = command;
+        break;
+    case 0x40:
+    case 0x60:
+        // key data or INT flag address pointer
+        _pointer = command;
+        break;
+    case 0x80:
+        _display_setup = command;
+        break;
+    case 0xE0:
+        _dimming = command;
+        break;
+    default:
+        // ROW/INT set and test mode are not modeled
+        break;
+    }
+}
+
+uint8_t SimulatedHT16K33::_readByte(uint8_t pointer) const {
+    if (pointer < 0x10) {
+        return _display_ram[pointer];
+    }
+    if (pointer >= 0x40 && pointer < 0x46) {
+        // key scanning only happens while the oscillator is running, key RAM is reset in standby
+        if (!isOscillatorOn()) {
+            return 0;
+        }
+        uint16_t column = _key_state[(pointer - 0x40) / 2];
+        return (pointer & 1) ? column >> 8 : column & 0xFF;
+    }
+    if (pointer == 0x60) {
+        // INT flag is set if any key is pressed
+        return isOscillatorOn() && (_key_state[0] || _key_state[1] || _key_state[2]) ? 0xFF : 0x00;
+    }
+    return 0;
+}
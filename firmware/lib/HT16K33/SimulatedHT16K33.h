@@ -0,0 +1,66 @@
+#ifndef _SIMULATED_HT16K33_H
+#define _SIMULATED_HT16K33_H
+
+#include <I2CBus.h>
+
+// I2C bus with a single simulated HT16K33 attached, for native builds
+// models display RAM, key RAM and the command registers, as described in the datasheet
+class SimulatedHT16K33 : public I2CBus {
+public:
+    SimulatedHT16K33(uint8_t addr = 0x70);
+
+    virtual bool write(uint8_t addr, const uint8_t *data, size_t num) override;
+    virtual size_t read(uint8_t addr, uint8_t *data, size_t num) override;
+    virtual bool recover() override;
+
+    // sets the pressed keys of a key column (0 to 2), one bit per row
+    void setKeyColumn(uint8_t column, uint16_t row_bits);
+
+    // returns the contents of the display RAM for a column (0 to 7), one bit per row
+    uint16_t getLedColumn(uint8_t column) const;
+
+    bool isOscillatorOn() const;
+    bool isDisplayOn() const;
+    uint8_t getBlinkRate() const;
+    uint8_t getBrightness() const;
+
+    // fault injection: the next num write transactions are not acknowledged after half of their bytes have been applied
+    void injectNacks(uint32_t num);
+    // fault injection: the next num read transactions return only half of the requested bytes
+    void injectShortReads(uint32_t num);
+    // fault injection: SDA is held low, so that all transactions fail until the bus is recovered
+    void setBusStuck(bool stuck);
+
+    uint32_t getWriteTransactionCount() const;
+    uint32_t getReadTransactionCount() const;
+    uint32_t getWrittenByteCount() const;
+    uint32_t getReadByteCount() const;
+    void resetCounters();
+
+private:
+    uint8_t _addr;
+
+    uint8_t _display_ram[16];
+    uint16_t _key_state[3];
+
+    uint8_t _system_setup;
+    uint8_t _display_setup;
+    uint8_t _dimming;
+
+    // last address pointer command (0x00-0x0F for display RAM, 0x40-0x45 for key RAM, 0x60 for INT flag)
+    uint8_t _pointer;
+
+    uint32_t _nacks;
+    uint32_t _short_reads;
+    bool _bus_stuck;
+
+    uint32_t _write_transaction_count;
+    uint32_t _read_transaction_count;
+    uint32_t _written_byte_count;
+    uint32_t _read_byte_count;
+
+    void _applyWrite(const uint8_t *data, size_t num);
+    uint8_t _readByte(uint8_t pointer) const;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _TWO_WIRE_I2C_BUS_H
+#define _TWO_WIRE_I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <I2CBus.h>
+
+// I2C bus backed by an Arduino TwoWire instance (header-only, because Wire is not available in native builds)
+class TwoWireI2CBus : public I2CBus {
+public:
+    // the pins are only used for bus recovery, Wire must have been started on them
+    TwoWireI2CBus(TwoWire &wire, uint8_t sda_pin, uint8_t scl_pin) : _wire(wire), _sda_pin(sda_pin), _scl_pin(scl_pin), _clock(100000) {
+    }
+
+    virtual bool write(uint8_t addr, const uint8_t *data, size_t num) override {
+        _wire.beginTransmission(addr);
+        _wire.write(data, num);
+        return _wire.endTransmission() == 0;
+    }
+
+    virtual size_t read(uint8_t addr, uint8_t *data, size_t num) override {
+        size_t actual_num = _wire.requestFrom(addr, num, true);
+        for (size_t i = 0; i < actual_num; i++) {
+            data[i] = _wire.read();
+        }
+        return actual_num;
+    }
+
+    virtual size_t writeRead(uint8_t addr, const uint8_t *write_data, size_t write_num, uint8_t *read_data, size_t read_num) override {
+        // repeated start instead of stop between both transactions
+        _wire.beginTransmission(addr);
+        _wire.write(write_data, write_num);
+        if (_wire.endTransmission(false) != 0) {
+            return 0;
+        }
+        return read(addr, read_data, read_num);
+    }
+
+    virtual void setClock(uint32_t frequency) override {
+        _clock = frequency;
+        _wire.setClock(frequency);
+    }
+
+    virtual bool recover() override {
+        pinMode(_sda_pin, INPUT_PULLUP);
+        if (digitalRead(_sda_pin)) {
+            // bus is idle, nothing to do
+            return true;
+        }
+
+        // a device holds SDA low in the middle of a byte, up to nine clocks let it finish the byte and the (not) acknowledge bit
+        pinMode(_scl_pin, OUTPUT_OPEN_DRAIN);
+        for (uint8_t i = 0; i < 9 && !digitalRead(_sda_pin); i++) {
+            digitalWrite(_scl_pin, LOW);
+            delayMicroseconds(5);
+            digitalWrite(_scl_pin, HIGH);
+            delayMicroseconds(5);
+        }
+
+        // stop condition (SDA rising while SCL is high)
+        pinMode(_sda_pin, OUTPUT_OPEN_DRAIN);
+        digitalWrite(_scl_pin, LOW);
+        digitalWrite(_sda_pin, LOW);
+        delayMicroseconds(5);
+        digitalWrite(_scl_pin, HIGH);
+        delayMicroseconds(5);
+        digitalWrite(_sda_pin, HIGH);
+        delayMicroseconds(5);
+
+        pinMode(_sda_pin, INPUT_PULLUP);
+        bool idle = digitalRead(_sda_pin);
+
+        // hand the pins back to Wire
+        _wire.begin(_sda_pin, _scl_pin);
+        _wire.setClock(_clock);
+        return idle;
+    }
+
+private:
+    TwoWire &_wire;
+    uint8_t _sda_pin;
+    uint8_t _scl_pin;
+    uint32_t _clock;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include <Arduino.h>
+
+#include <KeyEvents.h>
+
+KeyEventQueue::KeyEventQueue() : _events(), _head(0), _count(0), _dropped(0) {
+}
+
+bool KeyEventQueue::push(const KeyEvent &event) {
+    if (_count == KEY_EVENTS_QUEUE_SIZE) {
+        _dropped++;
+        return false;
+    }
+    _events[(_head + _count++) % KEY_EVENTS_QUEUE_SIZE] = event;
+    return true;
+}
+
+bool KeyEventQueue::pop(KeyEvent &event) {
+    if (!_count) {
+        return false;
+    }
+    event = _events[_head];
+    _head = (_head + 1) % KEY_EVENTS_QUEUE_SIZE;
+    _count--;
+    return true;
+}
+
+uint32_t KeyEventQueue::getDropped() {
+    return _dropped;
+}
+
+KeyEventDetector::KeyEventDetector() : _keys(0), _change_micros(), _long_press_sent(), _repeat_count() {
+}
+
+void KeyEventDetector::update(uint16_t keys, unsigned long cur_micros, KeyEventQueue &queue) {
+    for (uint8_t key = 0; key < KEY_EVENTS_MAX_KEYS; key++) {
+        uint16_t mask = 1 << key;
+        bool pressed = _keys & mask;
+        unsigned long held_millis = (cur_micros - _change_micros[key]) / 1000;
+
+        if (pressed != (bool) (keys & mask) && held_millis >= KEY_EVENTS_DEBOUNCE_MILLIS) {
+            pressed = !pressed;
+            _keys ^= mask;
+            _change_micros[key] = cur_micros;
+            _long_press_sent[key] = false;
+            _repeat_count[key] = 0;
+            queue.push({ key, pressed ? KEY_EVENT_PRESS : KEY_EVENT_RELEASE, 0, cur_micros });
+            continue;
+        }
+
+        if (!pressed) {
+            continue;
+        }
+
+        if (!_long_press_sent[key] && held_millis >= KEY_EVENTS_LONG_PRESS_MILLIS) {
+            _long_press_sent[key] = true;
+            queue.push({ key, KEY_EVENT_LONG_PRESS, 0, cur_micros });
+        }
+
+        // a single repeat per sample, skipping missed ones, so that late samples don't cause bursts
+        if (held_millis >= KEY_EVENTS_REPEAT_DELAY_MILLIS + (unsigned long) _repeat_count[key] * KEY_EVENTS_REPEAT_INTERVAL_MILLIS) {
+            _repeat_count[key] = (held_millis - KEY_EVENTS_REPEAT_DELAY_MILLIS) / KEY_EVENTS_REPEAT_INTERVAL_MILLIS + 1;
+            queue.push({ key, KEY_EVENT_REPEAT, _repeat_count[key], cur_micros });
+        }
+    }
+}
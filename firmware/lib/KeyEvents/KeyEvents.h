@@ -0,0 +1,73 @@
+#ifndef _KEY_EVENTS_H
+#define _KEY_EVENTS_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// maximum number of keys (bits of a key column)
+#define KEY_EVENTS_MAX_KEYS 13
+
+// changes of a key within this time after its last change are ignored (leading-edge debouncing, so presses are not delayed)
+#define KEY_EVENTS_DEBOUNCE_MILLIS 30
+
+#define KEY_EVENTS_LONG_PRESS_MILLIS 800
+#define KEY_EVENTS_REPEAT_DELAY_MILLIS 400
+#define KEY_EVENTS_REPEAT_INTERVAL_MILLIS 100
+
+// number of events the queue can hold, further events are dropped
+#define KEY_EVENTS_QUEUE_SIZE 16
+
+enum KeyEventType {
+    KEY_EVENT_PRESS,
+    KEY_EVENT_RELEASE,
+    // once per press, after the key has been held for KEY_EVENTS_LONG_PRESS_MILLIS
+    KEY_EVENT_LONG_PRESS,
+    // while the key is held, after KEY_EVENTS_REPEAT_DELAY_MILLIS every KEY_EVENTS_REPEAT_INTERVAL_MILLIS
+    KEY_EVENT_REPEAT
+};
+
+struct KeyEvent {
+    uint8_t key;
+    KeyEventType type;
+    // number of repeats since the press (1 for the first KEY_EVENT_REPEAT)
+    uint16_t repeat_count;
+    // time (as returned by micros()) of the key sample the event has been detected in
+    unsigned long micros;
+};
+
+// fixed-size ring buffer of key events
+class KeyEventQueue {
+public:
+    KeyEventQueue();
+
+    // returns false if the queue is full (the event is dropped then)
+    bool push(const KeyEvent &event);
+
+    // returns false if the queue is empty
+    bool pop(KeyEvent &event);
+
+    uint32_t getDropped();
+
+private:
+    KeyEvent _events[KEY_EVENTS_QUEUE_SIZE];
+    uint8_t _head;
+    uint8_t _count;
+    uint32_t _dropped;
+};
+
+// generates key events from samples of the key state (bit i is key i)
+class KeyEventDetector {
+public:
+    KeyEventDetector();
+
+    // must be called for every key sample, and regularly while keys are held
+    void update(uint16_t keys, unsigned long cur_micros, KeyEventQueue &queue);
+
+private:
+    uint16_t _keys;
+    unsigned long _change_micros[KEY_EVENTS_MAX_KEYS];
+    bool _long_press_sent[KEY_EVENTS_MAX_KEYS];
+    uint16_t _repeat_count[KEY_EVENTS_MAX_KEYS];
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include <Arduino.h>
+
+#include <string.h>
+
+#include <LoopProfiler.h>
+
+static const char LOOP_PROFILER_LOOP_PERIOD_NAME[] PROGMEM = "loop_period_us";
+static const char LOOP_PROFILER_CAPTIVE_CONFIG_NAME[] PROGMEM = "captive_config_us";
+static const char LOOP_PROFILER_UPDATE_KEYS_NAME[] PROGMEM = "update_keys_us";
+static const char LOOP_PROFILER_UPDATE_LEDS_NAME[] PROGMEM = "update_leds_us";
+static const char LOOP_PROFILER_I2C_TRANSACTIONS_PER_SECOND_NAME[] PROGMEM = "i2c_transactions_per_s";
+static const char LOOP_PROFILER_I2C_BYTES_PER_SECOND_NAME[] PROGMEM = "i2c_bytes_per_s";
+
+static PGM_P const LOOP_PROFILER_SECTION_NAMES[LOOP_PROFILER_NUM_SECTIONS] = {
+    LOOP_PROFILER_LOOP_PERIOD_NAME,
+    LOOP_PROFILER_CAPTIVE_CONFIG_NAME,
+    LOOP_PROFILER_UPDATE_KEYS_NAME,
+    LOOP_PROFILER_UPDATE_LEDS_NAME,
+    LOOP_PROFILER_I2C_TRANSACTIONS_PER_SECOND_NAME,
+    LOOP_PROFILER_I2C_BYTES_PER_SECOND_NAME,
+};
+
+struct LoopProfilerApp {
+    const char *name;
+    LoopProfilerHistogram histogram;
+};
+
+static LoopProfilerHistogram loop_profiler_sections[LOOP_PROFILER_NUM_SECTIONS];
+static LoopProfilerApp loop_profiler_apps[LOOP_PROFILER_MAX_APPS];
+
+static uint32_t loop_profiler_loop_cycles;
+static bool loop_profiler_loop_valid = false;
+
+static uint32_t loop_profiler_i2c_transactions;
+static uint32_t loop_profiler_i2c_bytes;
+static unsigned long loop_profiler_i2c_millis;
+static bool loop_profiler_i2c_valid = false;
+
+void LoopProfilerHistogram::add(uint32_t value) {
+    uint8_t bucket = value ? 32 - __builtin_clz(value) : 0;
+    if (bucket >= LOOP_PROFILER_BUCKETS) {
+        bucket = LOOP_PROFILER_BUCKETS - 1;
+    }
+    buckets[bucket]++;
+    count++;
+    sum += value;
+    if (value > max) {
+        max = value;
+    }
+}
+
+void LoopProfiler::record(LoopProfilerSection section, uint32_t value) {
+    loop_profiler_sections[section].add(value);
+}
+
+void LoopProfiler::recordLoopPeriod() {
+    if (loop_profiler_loop_valid) {
+        record(LOOP_PROFILER_LOOP_PERIOD, getMicrosSince(loop_profiler_loop_cycles));
+    }
+    loop_profiler_loop_cycles = getCycles();
+    loop_profiler_loop_valid = true;
+}
+
+void LoopProfiler::recordApp(const char *name, uint32_t value) {
+    for (LoopProfilerApp &app : loop_profiler_apps) {
+        if (!app.name) {
+            app.name = name;
+        }
+        if (app.name == name) {
+            app.histogram.add(value);
+            return;
+        }
+    }
+    // no free slot, drop the value
+}
+
+void LoopProfiler::recordI2C(uint32_t transactions, uint32_t bytes) {
+    unsigned long cur_millis = millis();
+    if (!loop_profiler_i2c_valid) {
+        loop_profiler_i2c_valid = true;
+    } else if (cur_millis - loop_profiler_i2c_millis >= 1000) {
+        // scale to exactly one second, the loop may have been late
+        unsigned long elapsed_millis = cur_millis - loop_profiler_i2c_millis;
+        record(LOOP_PROFILER_I2C_TRANSACTIONS_PER_SECOND, (uint64_t) (transactions - loop_profiler_i2c_transactions) * 1000 / elapsed_millis);
+        record(LOOP_PROFILER_I2C_BYTES_PER_SECOND, (uint64_t) (bytes - loop_profiler_i2c_bytes) * 1000 / elapsed_millis);
+    } else {
+        return;
+    }
+    loop_profiler_i2c_transactions = transactions;
+    loop_profiler_i2c_bytes = bytes;
+    loop_profiler_i2c_millis = cur_millis;
+}
+
+void LoopProfiler::reset() {
+    memset(loop_profiler_sections, 0, sizeof(loop_profiler_sections));
+    memset(loop_profiler_apps, 0, sizeof(loop_profiler_apps));
+    loop_profiler_loop_valid = false;
+    loop_profiler_i2c_valid = false;
+}
+
+static size_t formatHistogram(char *buffer, size_t size, const char *prefix, const char *name, const LoopProfilerHistogram &histogram) {
+    size_t length = 0;
+
+    int len = snprintf_P(buffer, size, PSTR("%s%s count=%lu avg=%lu max=%lu"), prefix, name, (unsigned long) histogram.count,
+        (unsigned long) (histogram.count ? histogram.sum / histogram.count : 0), (unsigned long) histogram.max);
+    if (len > 0) {
+        length += len;
+    }
+
+    // only non-empty buckets, as "<upper bound>:count" (the last bucket has no upper bound)
+    for (uint8_t i = 0; i < LOOP_PROFILER_BUCKETS; i++) {
+        if (histogram.buckets[i]) {
+            if (i < LOOP_PROFILER_BUCKETS - 1) {
+                len = snprintf_P(length < size ? buffer + length : nullptr, length < size ? size - length : 0, PSTR(" <%lu:%lu"), 1UL << i, (unsigned long) histogram.buckets[i]);
+            } else {
+                len = snprintf_P(length < size ? buffer + length : nullptr, length < size ? size - length : 0, PSTR(" >=%lu:%lu"), 1UL << (i - 1), (unsigned long) histogram.buckets[i]);
+            }
+            if (len > 0) {
+                length += len;
+            }
+        }
+    }
+
+    len = snprintf_P(length < size ? buffer + length : nullptr, length < size ? size - length : 0, PSTR("\n"));
+    if (len > 0) {
+        length += len;
+    }
+
+    return length;
+}
+
+size_t LoopProfiler::formatLine(size_t index, char *buffer, size_t size) {
+    if (index < LOOP_PROFILER_NUM_SECTIONS) {
+        char name[24];
+        strncpy_P(name, LOOP_PROFILER_SECTION_NAMES[index], sizeof(name) - 1);
+        name[sizeof(name) - 1] = 0;
+        return formatHistogram(buffer, size, "", name, loop_profiler_sections[index]);
+    }
+    index -= LOOP_PROFILER_NUM_SECTIONS;
+
+    if (index < LOOP_PROFILER_MAX_APPS && loop_profiler_apps[index].name) {
+        return formatHistogram(buffer, size, "app_update_us:", loop_profiler_apps[index].name, loop_profiler_apps[index].histogram);
+    }
+
+    return 0;
+}
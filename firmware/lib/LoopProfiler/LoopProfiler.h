@@ -0,0 +1,80 @@
+#ifndef _LOOP_PROFILER_H
+#define _LOOP_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Arduino.h>
+
+// number of logarithmic histogram buckets, bucket i counts values below 2^i (bucket 0 only counts 0)
+#define LOOP_PROFILER_BUCKETS 21
+
+// maximum number of distinct app names with their own update histogram
+#define LOOP_PROFILER_MAX_APPS 6
+
+// buffer size sufficient for a single formatted line
+#define LOOP_PROFILER_LINE_SIZE 384
+
+enum LoopProfilerSection {
+    LOOP_PROFILER_LOOP_PERIOD,
+    LOOP_PROFILER_CAPTIVE_CONFIG,
+    LOOP_PROFILER_UPDATE_KEYS,
+    LOOP_PROFILER_UPDATE_LEDS,
+    LOOP_PROFILER_I2C_TRANSACTIONS_PER_SECOND,
+    LOOP_PROFILER_I2C_BYTES_PER_SECOND,
+    LOOP_PROFILER_NUM_SECTIONS
+};
+
+struct LoopProfilerHistogram {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[LOOP_PROFILER_BUCKETS];
+
+    void add(uint32_t value);
+};
+
+// fixed-size histograms of loop timings (in microseconds) and I2C rates, without heap allocations
+// the LOOP_PROFILER_* macros below only record anything if LOOP_PROFILER is defined, and compile to nothing otherwise
+class LoopProfiler {
+public:
+    static void record(LoopProfilerSection section, uint32_t value);
+
+    // records the time since the last call as loop period
+    static void recordLoopPeriod();
+
+    // records the update time of an app, the name must be valid until reset (e.g. a string literal)
+    static void recordApp(const char *name, uint32_t value);
+
+    // records the I2C rates, based on the total counts (sampled once per second)
+    static void recordI2C(uint32_t transactions, uint32_t bytes);
+
+    // returns the number of cycles since reset, to measure sections
+    static uint32_t getCycles() {
+        return ESP.getCycleCount();
+    }
+
+    // returns the number of microseconds since start (as returned by getCycles)
+    static uint32_t getMicrosSince(uint32_t start) {
+        return (ESP.getCycleCount() - start) / ESP.getCpuFreqMHz();
+    }
+
+    static void reset();
+
+    // formats a single histogram line into the buffer like snprintf, returns 0 after the last line
+    static size_t formatLine(size_t index, char *buffer, size_t size);
+};
+
+#ifdef LOOP_PROFILER
+#define LOOP_PROFILER_LOOP() LoopProfiler::recordLoopPeriod()
+#define LOOP_PROFILER_START(name) uint32_t name = LoopProfiler::getCycles()
+#define LOOP_PROFILER_STOP(name, section) LoopProfiler::record(section, LoopProfiler::getMicrosSince(name))
+#define LOOP_PROFILER_STOP_APP(name, app_name) LoopProfiler::recordApp(app_name, LoopProfiler::getMicrosSince(name))
+#else
+#define LOOP_PROFILER_LOOP()
+#define LOOP_PROFILER_START(name)
+#define LOOP_PROFILER_STOP(name, section)
+#define LOOP_PROFILER_STOP_APP(name, app_name)
+#endif
+
+#endif
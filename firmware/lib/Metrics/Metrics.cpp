@@ -0,0 +1,282 @@
+#include <Arduino.h>
+
+#include <Metrics.h>
+
+// {0}: value
+const char METRICS_UPTIME_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_uptime_seconds Time since reset.\n"
+    "# TYPE wificlock_uptime_seconds counter\n"
+    "wificlock_uptime_seconds {0}\n";
+const char METRICS_FREE_HEAP_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_heap_free_bytes Free heap.\n"
+    "# TYPE wificlock_heap_free_bytes gauge\n"
+    "wificlock_heap_free_bytes {0}\n";
+const char METRICS_MAX_FREE_BLOCK_SIZE_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_heap_max_free_block_bytes Largest free heap block.\n"
+    "# TYPE wificlock_heap_max_free_block_bytes gauge\n"
+    "wificlock_heap_max_free_block_bytes {0}\n";
+const char METRICS_FREE_HEAP_MIN_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_heap_free_min_bytes Lowest free heap since start.\n"
+    "# TYPE wificlock_heap_free_min_bytes gauge\n"
+    "wificlock_heap_free_min_bytes {0}\n";
+const char METRICS_MAX_FREE_BLOCK_SIZE_MIN_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_heap_max_free_block_min_bytes Lowest largest free heap block since start.\n"
+    "# TYPE wificlock_heap_max_free_block_min_bytes gauge\n"
+    "wificlock_heap_max_free_block_min_bytes {0}\n";
+const char METRICS_HEAP_FRAGMENTATION_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_heap_fragmentation_ratio Heap fragmentation (0 to 1).\n"
+    "# TYPE wificlock_heap_fragmentation_ratio gauge\n"
+    "wificlock_heap_fragmentation_ratio {0}\n";
+const char METRICS_LOOP_RATE_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_loop_rate_hertz Main loop iterations during the last full second.\n"
+    "# TYPE wificlock_loop_rate_hertz gauge\n"
+    "wificlock_loop_rate_hertz {0}\n";
+const char METRICS_I2C_TRANSACTIONS_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_i2c_transactions_total I2C transactions.\n"
+    "# TYPE wificlock_i2c_transactions_total counter\n"
+    "wificlock_i2c_transactions_total {0}\n";
+const char METRICS_I2C_BYTES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_i2c_bytes_total Bytes transferred over I2C.\n"
+    "# TYPE wificlock_i2c_bytes_total counter\n"
+    "wificlock_i2c_bytes_total {0}\n";
+const char METRICS_I2C_ERRORS_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_i2c_errors_total Failed I2C transactions (after retries).\n"
+    "# TYPE wificlock_i2c_errors_total counter\n"
+    "wificlock_i2c_errors_total {0}\n";
+const char METRICS_I2C_RETRIES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_i2c_retries_total Retried I2C transactions.\n"
+    "# TYPE wificlock_i2c_retries_total counter\n"
+    "wificlock_i2c_retries_total {0}\n";
+const char METRICS_I2C_RECOVERIES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_i2c_recoveries_total I2C bus recovery attempts.\n"
+    "# TYPE wificlock_i2c_recoveries_total counter\n"
+    "wificlock_i2c_recoveries_total {0}\n";
+const char METRICS_I2C_FAST_MODE_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_i2c_fast_mode Whether the I2C bus runs at 400 kHz (it falls back to 100 kHz on errors).\n"
+    "# TYPE wificlock_i2c_fast_mode gauge\n"
+    "wificlock_i2c_fast_mode {0}\n";
+const char METRICS_LED_UPDATES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_led_updates_total LED memory writes to the display.\n"
+    "# TYPE wificlock_led_updates_total counter\n"
+    "wificlock_led_updates_total {0}\n";
+const char METRICS_LED_BYTES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_led_bytes_total Bytes of LED memory writes (including the address).\n"
+    "# TYPE wificlock_led_bytes_total counter\n"
+    "wificlock_led_bytes_total {0}\n";
+const char METRICS_LED_UPDATES_SKIPPED_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_led_updates_skipped_total LED updates without a write because nothing changed.\n"
+    "# TYPE wificlock_led_updates_skipped_total counter\n"
+    "wificlock_led_updates_skipped_total {0}\n";
+const char METRICS_LED_BYTES_SAVED_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_led_bytes_saved_total Bytes not sent compared to writing all LED memory on every update.\n"
+    "# TYPE wificlock_led_bytes_saved_total counter\n"
+    "wificlock_led_bytes_saved_total {0}\n";
+const char METRICS_LED_UPDATE_FAILURES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_led_update_failures_total Failed LED memory writes.\n"
+    "# TYPE wificlock_led_update_failures_total counter\n"
+    "wificlock_led_update_failures_total {0}\n";
+const char METRICS_CONFIG_JOURNAL_ENABLED_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_config_journal_enabled Whether the configuration is stored in the flash journal (instead of EEPROM).\n"
+    "# TYPE wificlock_config_journal_enabled gauge\n"
+    "wificlock_config_journal_enabled {0}\n";
+const char METRICS_CONFIG_FLASH_WRITES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_config_flash_writes_total Flash writes of the configuration and network cache journals.\n"
+    "# TYPE wificlock_config_flash_writes_total counter\n"
+    "wificlock_config_flash_writes_total {0}\n";
+const char METRICS_CONFIG_FLASH_ERASES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_config_flash_erases_total Flash sector erases of the configuration and network cache journals.\n"
+    "# TYPE wificlock_config_flash_erases_total counter\n"
+    "wificlock_config_flash_erases_total {0}\n";
+const char METRICS_WIFI_CONNECTED_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_wifi_connected Whether the station is connected.\n"
+    "# TYPE wificlock_wifi_connected gauge\n"
+    "wificlock_wifi_connected {0}\n";
+const char METRICS_WIFI_RSSI_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_wifi_rssi_dbm Signal strength of the access point.\n"
+    "# TYPE wificlock_wifi_rssi_dbm gauge\n"
+    "wificlock_wifi_rssi_dbm {0}\n";
+const char METRICS_WIFI_RECONNECTS_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_wifi_reconnects_total Station connections after the first one.\n"
+    "# TYPE wificlock_wifi_reconnects_total counter\n"
+    "wificlock_wifi_reconnects_total {0}\n";
+const char METRICS_WIFI_FAST_CONNECT_ATTEMPTED_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_wifi_fast_connect_attempted Whether connecting with the cached access point and IP lease has been attempted since reset.\n"
+    "# TYPE wificlock_wifi_fast_connect_attempted gauge\n"
+    "wificlock_wifi_fast_connect_attempted {0}\n";
+const char METRICS_WIFI_FAST_CONNECT_SUCCEEDED_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_wifi_fast_connect_succeeded Whether connecting with the cached access point and IP lease has succeeded since reset.\n"
+    "# TYPE wificlock_wifi_fast_connect_succeeded gauge\n"
+    "wificlock_wifi_fast_connect_succeeded {0}\n";
+const char METRICS_WIFI_GOT_IP_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_wifi_got_ip_seconds Time from reset until the station got its first IP.\n"
+    "# TYPE wificlock_wifi_got_ip_seconds gauge\n"
+    "wificlock_wifi_got_ip_seconds {0}\n";
+const char METRICS_SNTP_SYNCS_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_sntp_syncs_total Times the clock has been set by SNTP.\n"
+    "# TYPE wificlock_sntp_syncs_total counter\n"
+    "wificlock_sntp_syncs_total {0}\n";
+const char METRICS_SNTP_LAST_SYNC_AGE_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_sntp_last_sync_age_seconds Time since the clock has last been set by SNTP.\n"
+    "# TYPE wificlock_sntp_last_sync_age_seconds gauge\n"
+    "wificlock_sntp_last_sync_age_seconds {0}\n";
+const char METRICS_SNTP_LAST_OFFSET_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_sntp_last_offset_seconds Offset of the last SNTP sample to the disciplined clock.\n"
+    "# TYPE wificlock_sntp_last_offset_seconds gauge\n"
+    "wificlock_sntp_last_offset_seconds {0}\n";
+
+const char METRICS_SNTP_SPIKES_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_sntp_spikes_total SNTP samples ignored because of a large offset.\n"
+    "# TYPE wificlock_sntp_spikes_total counter\n"
+    "wificlock_sntp_spikes_total {0}\n";
+const char METRICS_TIME_STEPS_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_time_steps_total Times the clock has been stepped instead of slewed.\n"
+    "# TYPE wificlock_time_steps_total counter\n"
+    "wificlock_time_steps_total {0}\n";
+const char METRICS_TIME_FREQUENCY_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_time_frequency_error_ratio Estimated frequency error of the oscillator (positive if slow).\n"
+    "# TYPE wificlock_time_frequency_error_ratio gauge\n"
+    "wificlock_time_frequency_error_ratio {0}\n";
+
+// {0}: upper bound, {1}: cumulative count
+const char METRICS_FRAME_COMMIT_ERROR_HEADER_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_frame_commit_error_seconds Delay of scheduled frame commits after their scheduled time.\n"
+    "# TYPE wificlock_frame_commit_error_seconds histogram\n";
+const char METRICS_FRAME_COMMIT_ERROR_BUCKET_TEMPLATE[] PROGMEM =
+    "wificlock_frame_commit_error_seconds_bucket{le=\"{0}\"} {1}\n";
+const char METRICS_FRAME_COMMIT_ERROR_SUM_TEMPLATE[] PROGMEM =
+    "wificlock_frame_commit_error_seconds_sum {0}\n";
+const char METRICS_FRAME_COMMIT_ERROR_COUNT_TEMPLATE[] PROGMEM =
+    "wificlock_frame_commit_error_seconds_count {0}\n";
+const char METRICS_KEY_LATENCY_HEADER_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_key_latency_seconds Delay from sampling a key event until the resulting LED update.\n"
+    "# TYPE wificlock_key_latency_seconds histogram\n";
+const char METRICS_KEY_LATENCY_BUCKET_TEMPLATE[] PROGMEM =
+    "wificlock_key_latency_seconds_bucket{le=\"{0}\"} {1}\n";
+const char METRICS_KEY_LATENCY_SUM_TEMPLATE[] PROGMEM =
+    "wificlock_key_latency_seconds_sum {0}\n";
+const char METRICS_KEY_LATENCY_COUNT_TEMPLATE[] PROGMEM =
+    "wificlock_key_latency_seconds_count {0}\n";
+const char METRICS_KEY_EVENTS_DROPPED_TEMPLATE[] PROGMEM =
+    "# HELP wificlock_key_events_dropped_total Key events dropped because the queue was full.\n"
+    "# TYPE wificlock_key_events_dropped_total counter\n"
+    "wificlock_key_events_dropped_total {0}\n";
+
+static void formatMicros(char *str, size_t size, int64_t micros) {
+    uint64_t abs_micros = micros < 0 ? -micros : micros;
+    snprintf_P(str, size, PSTR("%s%lu.%06lu"), micros < 0 ? "-" : "", (unsigned long) (abs_micros / 1000000), (unsigned long) (abs_micros % 1000000));
+}
+
+static void writeMetric(TemplateWriter &writer, PGM_P tmpl, const char *value) {
+    writer.writeTemplate(tmpl, &value, 1);
+}
+
+static void writeMetric(TemplateWriter &writer, PGM_P tmpl, uint32_t value) {
+    char str[11];
+    snprintf_P(str, sizeof(str), PSTR("%lu"), (unsigned long) value);
+    writeMetric(writer, tmpl, str);
+}
+
+// writes the value in microseconds as seconds with six decimals
+static void writeMetricMicros(TemplateWriter &writer, PGM_P tmpl, int64_t micros) {
+    char str[24];
+    formatMicros(str, sizeof(str), micros);
+    writeMetric(writer, tmpl, str);
+}
+
+// writes a histogram of microseconds with cumulative buckets in seconds
+static void writeHistogramMicros(TemplateWriter &writer, PGM_P header_tmpl, PGM_P bucket_tmpl, PGM_P sum_tmpl, PGM_P count_tmpl,
+    const LoopProfilerHistogram &histogram) {
+    writer.writeTemplate(header_tmpl);
+
+    // bucket i counts values below 2^i, the last bucket is unbounded
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < LOOP_PROFILER_BUCKETS; i++) {
+        cumulative += histogram.buckets[i];
+        char le[24];
+        char count[11];
+        if (i < LOOP_PROFILER_BUCKETS - 1) {
+            // values are integers, so "below 2^i" is "at most 2^i - 1"
+            formatMicros(le, sizeof(le), (1L << i) - 1);
+        } else {
+            strcpy_P(le, PSTR("+Inf"));
+        }
+        snprintf_P(count, sizeof(count), PSTR("%lu"), (unsigned long) cumulative);
+        const char *values[] = { le, count };
+        writer.writeTemplate(bucket_tmpl, values, 2);
+    }
+
+    writeMetricMicros(writer, sum_tmpl, histogram.sum);
+    writeMetric(writer, count_tmpl, histogram.count);
+}
+
+void writeMetrics(TemplateWriter &writer, const MetricsSnapshot &snapshot) {
+    writeMetricMicros(writer, METRICS_UPTIME_TEMPLATE, snapshot.uptime_micros);
+
+    writeMetric(writer, METRICS_FREE_HEAP_TEMPLATE, snapshot.free_heap);
+    writeMetric(writer, METRICS_MAX_FREE_BLOCK_SIZE_TEMPLATE, snapshot.max_free_block_size);
+    writeMetric(writer, METRICS_FREE_HEAP_MIN_TEMPLATE, snapshot.free_heap_min);
+    writeMetric(writer, METRICS_MAX_FREE_BLOCK_SIZE_MIN_TEMPLATE, snapshot.max_free_block_size_min);
+    char fragmentation[5];
+    snprintf_P(fragmentation, sizeof(fragmentation), PSTR("%u.%02u"), snapshot.heap_fragmentation / 100, snapshot.heap_fragmentation % 100);
+    writeMetric(writer, METRICS_HEAP_FRAGMENTATION_TEMPLATE, fragmentation);
+
+    writeMetric(writer, METRICS_LOOP_RATE_TEMPLATE, snapshot.loop_rate);
+
+    writeMetric(writer, METRICS_I2C_TRANSACTIONS_TEMPLATE, snapshot.i2c_transactions);
+    writeMetric(writer, METRICS_I2C_BYTES_TEMPLATE, snapshot.i2c_bytes);
+    writeMetric(writer, METRICS_I2C_ERRORS_TEMPLATE, snapshot.i2c_errors);
+    writeMetric(writer, METRICS_I2C_RETRIES_TEMPLATE, snapshot.i2c_retries);
+    writeMetric(writer, METRICS_I2C_RECOVERIES_TEMPLATE, snapshot.i2c_recoveries);
+    writeMetric(writer, METRICS_I2C_FAST_MODE_TEMPLATE, snapshot.i2c_fast_mode ? 1 : 0);
+
+    writeMetric(writer, METRICS_LED_UPDATES_TEMPLATE, snapshot.led_updates);
+    writeMetric(writer, METRICS_LED_BYTES_TEMPLATE, snapshot.led_bytes);
+    writeMetric(writer, METRICS_LED_UPDATES_SKIPPED_TEMPLATE, snapshot.led_updates_skipped);
+    writeMetric(writer, METRICS_LED_BYTES_SAVED_TEMPLATE, snapshot.led_bytes_saved);
+    writeMetric(writer, METRICS_LED_UPDATE_FAILURES_TEMPLATE, snapshot.led_update_failures);
+
+    writeMetric(writer, METRICS_CONFIG_JOURNAL_ENABLED_TEMPLATE, snapshot.config_journal_enabled ? 1 : 0);
+    writeMetric(writer, METRICS_CONFIG_FLASH_WRITES_TEMPLATE, snapshot.config_flash_writes);
+    writeMetric(writer, METRICS_CONFIG_FLASH_ERASES_TEMPLATE, snapshot.config_flash_erases);
+
+    writeMetric(writer, METRICS_WIFI_CONNECTED_TEMPLATE, snapshot.wifi_connected ? 1 : 0);
+    if (snapshot.wifi_connected) {
+        char rssi[12];
+        snprintf_P(rssi, sizeof(rssi), PSTR("%ld"), (long) snapshot.wifi_rssi);
+        writeMetric(writer, METRICS_WIFI_RSSI_TEMPLATE, rssi);
+    }
+    writeMetric(writer, METRICS_WIFI_RECONNECTS_TEMPLATE, snapshot.wifi_reconnects);
+    writeMetric(writer, METRICS_WIFI_FAST_CONNECT_ATTEMPTED_TEMPLATE, snapshot.wifi_fast_connect_attempted ? 1 : 0);
+    writeMetric(writer, METRICS_WIFI_FAST_CONNECT_SUCCEEDED_TEMPLATE, snapshot.wifi_fast_connect_succeeded ? 1 : 0);
+    if (snapshot.wifi_got_ip_millis) {
+        writeMetricMicros(writer, METRICS_WIFI_GOT_IP_TEMPLATE, (int64_t) snapshot.wifi_got_ip_millis * 1000);
+    }
+
+    writeMetric(writer, METRICS_SNTP_SYNCS_TEMPLATE, snapshot.sntp_syncs);
+    if (snapshot.sntp_syncs >= 1) {
+        writeMetricMicros(writer, METRICS_SNTP_LAST_SYNC_AGE_TEMPLATE, snapshot.sntp_last_sync_age_micros);
+    }
+    if (snapshot.sntp_syncs >= 2) {
+        writeMetricMicros(writer, METRICS_SNTP_LAST_OFFSET_TEMPLATE, snapshot.sntp_last_offset_micros);
+    }
+    writeMetric(writer, METRICS_SNTP_SPIKES_TEMPLATE, snapshot.sntp_spikes);
+    writeMetric(writer, METRICS_TIME_STEPS_TEMPLATE, snapshot.time_steps);
+    if (snapshot.sntp_syncs >= 2) {
+        // parts per billion as ratio with nine decimals
+        int32_t ppb = snapshot.time_frequency_ppb;
+        uint32_t abs_ppb = ppb < 0 ? -ppb : ppb;
+        char frequency[16];
+        snprintf_P(frequency, sizeof(frequency), PSTR("%s0.%09lu"), ppb < 0 ? "-" : "", (unsigned long) abs_ppb);
+        writeMetric(writer, METRICS_TIME_FREQUENCY_TEMPLATE, frequency);
+    }
+
+    if (snapshot.frame_commit_errors) {
+        writeHistogramMicros(writer, METRICS_FRAME_COMMIT_ERROR_HEADER_TEMPLATE, METRICS_FRAME_COMMIT_ERROR_BUCKET_TEMPLATE, METRICS_FRAME_COMMIT_ERROR_SUM_TEMPLATE,
+            METRICS_FRAME_COMMIT_ERROR_COUNT_TEMPLATE, *snapshot.frame_commit_errors);
+    }
+    if (snapshot.key_latencies) {
+        writeHistogramMicros(writer, METRICS_KEY_LATENCY_HEADER_TEMPLATE, METRICS_KEY_LATENCY_BUCKET_TEMPLATE, METRICS_KEY_LATENCY_SUM_TEMPLATE,
+            METRICS_KEY_LATENCY_COUNT_TEMPLATE, *snapshot.key_latencies);
+    }
+    writeMetric(writer, METRICS_KEY_EVENTS_DROPPED_TEMPLATE, snapshot.key_events_dropped);
+}
@@ -0,0 +1,59 @@
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdint.h>
+
+#include <LoopProfiler.h>
+#include <TemplateWriter.h>
+
+struct MetricsSnapshot {
+    uint64_t uptime_micros;
+
+    uint32_t free_heap;
+    uint32_t max_free_block_size;
+    uint8_t heap_fragmentation;
+    uint32_t free_heap_min;
+    uint32_t max_free_block_size_min;
+
+    uint32_t loop_rate;
+
+    uint32_t i2c_transactions;
+    uint32_t i2c_bytes;
+    uint32_t i2c_errors; // after retries
+    uint32_t i2c_retries;
+    uint32_t i2c_recoveries;
+    bool i2c_fast_mode;
+
+    uint32_t led_updates;
+    uint32_t led_bytes;
+    uint32_t led_updates_skipped;
+    uint32_t led_bytes_saved;
+    uint32_t led_update_failures;
+
+    bool config_journal_enabled;
+    uint32_t config_flash_writes;
+    uint32_t config_flash_erases;
+
+    bool wifi_connected;
+    int32_t wifi_rssi; // only valid if connected
+    uint32_t wifi_reconnects;
+    bool wifi_fast_connect_attempted;
+    bool wifi_fast_connect_succeeded;
+    uint32_t wifi_got_ip_millis; // 0 if the station hasn't got an IP yet
+
+    uint32_t sntp_syncs;
+    uint64_t sntp_last_sync_age_micros; // only valid after the first sync
+    int64_t sntp_last_offset_micros; // only valid after the second sync
+    uint32_t sntp_spikes;
+    uint32_t time_steps;
+    int32_t time_frequency_ppb; // only valid after the second sync
+
+    const LoopProfilerHistogram *frame_commit_errors; // microseconds
+    const LoopProfilerHistogram *key_latencies; // microseconds
+    uint32_t key_events_dropped;
+};
+
+// renders the snapshot in the Prometheus text exposition format, metrics without a valid value are omitted
+void writeMetrics(TemplateWriter &writer, const MetricsSnapshot &snapshot);
+
+#endif
@@ -1,4 +1,5 @@
-#include <ctype.h>
+#include <Arduino.h>
+
 #include <inttypes.h>
 
 #include "SevenSegment.h"
@@ -8,7 +9,7 @@ struct mapping_t {
     uint16_t bits;
 };
 
-const mapping_t MAPPINGS[] = {
+constexpr mapping_t MAPPINGS[] = {
     { ' ', 0b00000000 },
     { '0', 0b00111111 },
     { '1', 0b00000110 }, 
@@ -50,39 +51,62 @@ const mapping_t MAPPINGS[] = {
     {   0, 0b00000000 }
 };
 
-static const mapping_t *findMapping(char ch) {
+// marks characters without mapping in the glyph tables (bit 15 is never used by a mapping)
+#define GLYPH_NONE 0x8000
+
+struct glyph_table_t {
+    uint16_t bits[256];
+};
+
+static constexpr char asciiToLower(char ch) {
+    return ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch;
+}
+
+static constexpr char asciiToUpper(char ch) {
+    return ch >= 'a' && ch <= 'z' ? ch - 'a' + 'A' : ch;
+}
+
+static constexpr uint16_t findBits(char ch) {
     for (const mapping_t *m = &MAPPINGS[0]; m->ch; m++) {
         if (m->ch == ch) {
-            return m;
+            return m->bits;
         }
     }
-    return nullptr;
+    return GLYPH_NONE;
 }
 
-static const mapping_t *findMappingWithCaseFallback(char ch) {
-    const mapping_t *m = findMapping(ch);
-    if (m != nullptr) {
-        return m;
+static constexpr uint16_t findBitsWithCaseFallback(char ch) {
+    uint16_t bits = findBits(ch);
+    if (bits != GLYPH_NONE) {
+        return bits;
     }
-    char ch2 = tolower(ch);
+    char ch2 = asciiToLower(ch);
     if (ch2 == ch) {
-        ch2 = toupper(ch);
+        ch2 = asciiToUpper(ch);
     }
     if (ch2 != ch) {
-        m = findMapping(ch2);
-        if (m != nullptr) {
-            return m;
-        }
+        return findBits(ch2);
     }
-    return nullptr;
+    return GLYPH_NONE;
 }
 
-uint16_t SevenSegmentClass::getBits(char ch, bool case_fallback, uint16_t default_bits) {
-    const mapping_t *m = case_fallback ? findMappingWithCaseFallback(ch) : findMapping(ch);
-    if (m != nullptr) {
-        return m->bits;
+static constexpr glyph_table_t buildGlyphTable(bool case_fallback) {
+    glyph_table_t table {};
+    for (int i = 0; i < 256; i++) {
+        char ch = static_cast<char>(i);
+        table.bits[i] = case_fallback ? findBitsWithCaseFallback(ch) : findBits(ch);
     }
-    return default_bits;
+    return table;
+}
+
+// direct-indexed glyph tables, built at compile time from MAPPINGS
+static constexpr glyph_table_t GLYPHS PROGMEM = buildGlyphTable(false);
+static constexpr glyph_table_t GLYPHS_WITH_CASE_FALLBACK PROGMEM = buildGlyphTable(true);
+
+uint16_t SevenSegmentClass::getBits(char ch, bool case_fallback, uint16_t default_bits) {
+    const glyph_table_t &table = case_fallback ? GLYPHS_WITH_CASE_FALLBACK : GLYPHS;
+    uint16_t bits = pgm_read_word(&table.bits[static_cast<uint8_t>(ch)]);
+    return bits != GLYPH_NONE ? bits : default_bits;
 }
 
 SevenSegmentClass SevenSegment;
@@ -1,6 +1,8 @@
 #ifndef _SEVEN_SEGMENT_H
 #define _SEVEN_SEGMENT_H
 
+#include <inttypes.h>
+
 class SevenSegmentClass {
 public:
     uint16_t getBits(char ch, bool case_fallback = false, uint16_t default_bits = DEFAULT_BITS);
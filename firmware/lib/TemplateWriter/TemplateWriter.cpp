@@ -0,0 +1,77 @@
+#include <Arduino.h>
+
+#include <TemplateWriter.h>
+
+TemplateWriter::TemplateWriter(TemplateSink *sink) : _sink(sink), _buffer_length(0), _length(0) {
+}
+
+void TemplateWriter::writeTemplate(PGM_P tmpl, const char *const *values, size_t num_values) {
+    char ch;
+    while ((ch = pgm_read_byte(tmpl++))) {
+        if (ch == '{') {
+            char index = pgm_read_byte(tmpl);
+            if (index >= '0' && index <= '9' && pgm_read_byte(tmpl + 1) == '}') {
+                size_t i = index - '0';
+                if (i < num_values && values[i] != nullptr) {
+                    writeEscaped(values[i]);
+                }
+                tmpl += 2;
+                continue;
+            }
+        }
+        _write(ch);
+    }
+}
+
+void TemplateWriter::writeEscaped(const char *value) {
+    for (const char *p = value; *p; p++) {
+        switch (*p) {
+        case '&':
+            _write("&amp;");
+            break;
+        case '<':
+            _write("&lt;");
+            break;
+        case '>':
+            _write("&gt;");
+            break;
+        case '"':
+            _write("&quot;");
+            break;
+        case '\'':
+            _write("&#39;");
+            break;
+        default:
+            _write(*p);
+            break;
+        }
+    }
+}
+
+void TemplateWriter::flush() {
+    if (_sink != nullptr && _buffer_length > 0) {
+        _sink->write(_buffer, _buffer_length);
+    }
+    _buffer_length = 0;
+}
+
+size_t TemplateWriter::getLength() {
+    return _length;
+}
+
+void TemplateWriter::_write(char ch) {
+    _length++;
+    if (_sink == nullptr) {
+        return;
+    }
+    if (_buffer_length == sizeof(_buffer)) {
+        flush();
+    }
+    _buffer[_buffer_length++] = ch;
+}
+
+void TemplateWriter::_write(const char *str) {
+    while (*str) {
+        _write(*str++);
+    }
+}
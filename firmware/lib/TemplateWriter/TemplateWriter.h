@@ -0,0 +1,48 @@
+#ifndef _TEMPLATE_WRITER_H
+#define _TEMPLATE_WRITER_H
+
+#include <stddef.h>
+
+#include <Arduino.h>
+
+#define TEMPLATE_WRITER_BUFFER_SIZE 256
+
+// receives the output of a TemplateWriter in chunks of at most TEMPLATE_WRITER_BUFFER_SIZE bytes
+class TemplateSink {
+public:
+    virtual void write(const char *data, size_t len) = 0;
+
+protected:
+    virtual ~TemplateSink() = default; // prevent delete on pointers to this type
+};
+
+// renders PROGMEM templates into a fixed-size buffer that is flushed to a sink when full, without heap allocations
+// placeholders {0} to {9} are replaced by the HTML-escaped value at the corresponding index
+// without a sink, the output is only counted (e.g. to determine the content length before sending)
+class TemplateWriter {
+public:
+    TemplateWriter(TemplateSink *sink = nullptr);
+
+    // writes the template, replacing placeholders with values
+    void writeTemplate(PGM_P tmpl, const char *const *values = nullptr, size_t num_values = 0);
+
+    // writes the HTML-escaped value
+    void writeEscaped(const char *value);
+
+    // writes all buffered output to the sink
+    void flush();
+
+    // returns the total number of bytes written so far
+    size_t getLength();
+
+private:
+    TemplateSink *_sink;
+    char _buffer[TEMPLATE_WRITER_BUFFER_SIZE];
+    size_t _buffer_length;
+    size_t _length;
+
+    void _write(char ch);
+    void _write(const char *str);
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _WEB_SERVER_TEMPLATE_SINK_H
+#define _WEB_SERVER_TEMPLATE_SINK_H
+
+#include <ESP8266WebServer.h>
+
+#include <TemplateWriter.h>
+
+// streams rendered templates to the current web server response (header-only, because the web server is not available in native builds)
+class WebServerTemplateSink : public TemplateSink {
+public:
+    WebServerTemplateSink(ESP8266WebServer &web_server) : _web_server(web_server) {
+    }
+
+    virtual void write(const char *data, size_t len) override {
+        _web_server.sendContent(data, len);
+    }
+
+private:
+    ESP8266WebServer &_web_server;
+};
+
+#endif
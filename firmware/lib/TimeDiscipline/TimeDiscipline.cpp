@@ -0,0 +1,135 @@
+#include <Arduino.h>
+
+#include <TimeDiscipline.h>
+
+TimeDiscipline::TimeDiscipline()
+    : _set(false), _anchor_mono(0), _anchor_time(0), _slew(0), _frequency_ppb(0), _last_offset(0), _last_sample_mono(0), _samples(0), _spikes(0), _steps(0), _spike_pending(false) {
+}
+
+void TimeDiscipline::addSample(int64_t mono_micros, int64_t ref_micros) {
+    _samples++;
+    _last_sample_mono = mono_micros;
+
+    if (!_set) {
+        _set = true;
+        _anchor_mono = mono_micros;
+        _anchor_time = ref_micros;
+        _slew = 0;
+        return;
+    }
+
+    int64_t elapsed = mono_micros - _anchor_mono;
+    int64_t time = getTime(mono_micros);
+    int64_t offset = ref_micros - time;
+    _last_offset = offset;
+
+    bool spike = offset > TIME_DISCIPLINE_SPIKE_THRESHOLD_MICROS || offset < -TIME_DISCIPLINE_SPIKE_THRESHOLD_MICROS;
+    if (spike && !_spike_pending) {
+        _spike_pending = true;
+        _spikes++;
+        return;
+    }
+    _spike_pending = false;
+
+    bool step = offset > TIME_DISCIPLINE_STEP_THRESHOLD_MICROS || offset < -TIME_DISCIPLINE_STEP_THRESHOLD_MICROS;
+
+    // the part of the previous offset that has not been slewed yet is not caused by the frequency error
+    int64_t frequency_offset = offset - (_slew - _getSlewed(elapsed));
+
+    // a step is caused by the reference (e.g. a corrected server), not by the frequency error, which
+    // can't add up to the step threshold within a usual sample interval
+    if (!step && elapsed >= TIME_DISCIPLINE_MIN_FREQUENCY_INTERVAL_MICROS) {
+        // correct half of the observed frequency error, to average sample noise over several intervals
+        // (the interval is divided first, so that the product stays far from overflowing)
+        int64_t frequency_ppb = _frequency_ppb + frequency_offset * 1000000LL / (elapsed / 1000) / 2;
+        if (frequency_ppb > TIME_DISCIPLINE_MAX_FREQUENCY_PPB) {
+            frequency_ppb = TIME_DISCIPLINE_MAX_FREQUENCY_PPB;
+        } else if (frequency_ppb < -TIME_DISCIPLINE_MAX_FREQUENCY_PPB) {
+            frequency_ppb = -TIME_DISCIPLINE_MAX_FREQUENCY_PPB;
+        }
+        _frequency_ppb = frequency_ppb;
+    }
+
+    _anchor_mono = mono_micros;
+    if (step) {
+        _anchor_time = ref_micros;
+        _slew = 0;
+        _steps++;
+    } else {
+        _anchor_time = time;
+        _slew = offset;
+    }
+}
+
+bool TimeDiscipline::isSet() {
+    return _set;
+}
+
+int64_t TimeDiscipline::getTime(int64_t mono_micros) {
+    int64_t elapsed = mono_micros - _anchor_mono;
+    return _anchor_time + elapsed + elapsed * _frequency_ppb / 1000000000LL + _getSlewed(elapsed);
+}
+
+int64_t TimeDiscipline::getMonoTime(int64_t time, int64_t mono_hint) {
+    // the rate is within 0.55% of 1 (slew rate and frequency correction), so a few fixed-point iterations converge to the microsecond
+    int64_t mono = mono_hint;
+    for (uint8_t i = 0; i < 3; i++) {
+        mono += time - getTime(mono);
+    }
+    while (getTime(mono) < time) {
+        mono++;
+    }
+    while (getTime(mono - 1) >= time) {
+        mono--;
+    }
+    return mono;
+}
+
+void TimeDiscipline::getTimeOfDay(timeval &tv) {
+    int64_t time = getTime(micros64());
+    tv.tv_sec = time / 1000000;
+    tv.tv_usec = time % 1000000;
+}
+
+int64_t TimeDiscipline::getLastOffset() {
+    return _last_offset;
+}
+
+int32_t TimeDiscipline::getFrequencyPpb() {
+    return _frequency_ppb;
+}
+
+int64_t TimeDiscipline::getRemainingSlew(int64_t mono_micros) {
+    return _slew - _getSlewed(mono_micros - _anchor_mono);
+}
+
+int64_t TimeDiscipline::getLastSampleMonoMicros() {
+    return _last_sample_mono;
+}
+
+uint32_t TimeDiscipline::getSamples() {
+    return _samples;
+}
+
+uint32_t TimeDiscipline::getSpikes() {
+    return _spikes;
+}
+
+uint32_t TimeDiscipline::getSteps() {
+    return _steps;
+}
+
+int64_t TimeDiscipline::_getSlewed(int64_t elapsed) {
+    // nothing has been slewed before the anchor (e.g. while searching in getMonoTime)
+    if (elapsed <= 0) {
+        return 0;
+    }
+
+    // the slew is applied linearly at the maximum rate, starting at the anchor
+    int64_t max_slewed = elapsed * TIME_DISCIPLINE_SLEW_RATE_PPM / 1000000;
+    if (_slew >= 0) {
+        return _slew < max_slewed ? _slew : max_slewed;
+    } else {
+        return -_slew < max_slewed ? _slew : -max_slewed;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef _TIME_DISCIPLINE_H
+#define _TIME_DISCIPLINE_H
+
+#include <inttypes.h>
+#include <sys/time.h>
+
+// maximum rate at which offsets are slewed, 0.5% is invisible in the colon blink
+#define TIME_DISCIPLINE_SLEW_RATE_PPM 5000
+
+// offsets beyond this are stepped instead of slewed (i.e. slewing would take longer than 100s)
+#define TIME_DISCIPLINE_STEP_THRESHOLD_MICROS 500000
+
+// limits of the oscillator frequency error estimate, crystals are well within this
+#define TIME_DISCIPLINE_MAX_FREQUENCY_PPB 500000
+
+// a single sample with an offset beyond this is ignored as a spike (e.g. a delayed SNTP response), a second one is applied
+#define TIME_DISCIPLINE_SPIKE_THRESHOLD_MICROS 100000
+
+// minimum time between samples to update the frequency estimate, because sample noise dominates on shorter intervals
+#define TIME_DISCIPLINE_MIN_FREQUENCY_INTERVAL_MICROS 60000000LL
+
+// a clock derived from a monotonic timer (e.g. micros64()) and disciplined by reference samples (e.g. from SNTP)
+// offsets are slewed instead of stepped, and the frequency error of the timer is estimated and compensated, also while no samples arrive
+// all times are microseconds, reference times are since the epoch
+class TimeDiscipline {
+public:
+    TimeDiscipline();
+
+    // adds a sample of the reference time at the given monotonic time
+    void addSample(int64_t mono_micros, int64_t ref_micros);
+
+    // returns true iff at least one sample has been added
+    bool isSet();
+
+    // returns the disciplined time at the given monotonic time
+    // before the last sample, the time is extrapolated backwards without slewing (it is still monotonic)
+    int64_t getTime(int64_t mono_micros);
+
+    // returns the first monotonic time at which the disciplined time reaches the given time (near mono_hint, after the last sample)
+    int64_t getMonoTime(int64_t time, int64_t mono_hint);
+
+    // returns the current disciplined time, like gettimeofday (based on micros64())
+    void getTimeOfDay(timeval &tv);
+
+    // returns the offset of the last sample to the disciplined time (positive if the disciplined time has been behind)
+    int64_t getLastOffset();
+
+    // returns the estimated frequency error of the monotonic timer in parts per billion (positive if it runs slow)
+    int32_t getFrequencyPpb();
+
+    // returns the part of the last offset that has not been slewed yet at the given monotonic time
+    int64_t getRemainingSlew(int64_t mono_micros);
+
+    // returns the monotonic time of the last sample (including ignored spikes)
+    int64_t getLastSampleMonoMicros();
+
+    uint32_t getSamples();
+    uint32_t getSpikes();
+    uint32_t getSteps();
+
+private:
+    bool _set;
+
+    // disciplined time at the anchor, before slewing
+    int64_t _anchor_mono;
+    int64_t _anchor_time;
+    int64_t _slew;
+    int32_t _frequency_ppb;
+
+    int64_t _last_offset;
+    int64_t _last_sample_mono;
+    uint32_t _samples;
+    uint32_t _spikes;
+    uint32_t _steps;
+    bool _spike_pending;
+
+    int64_t _getSlewed(int64_t elapsed);
+};
+
+#endif
@@ -0,0 +1,306 @@
+#include <Arduino.h>
+
+#include <ctype.h>
+#include <limits.h>
+#include <string.h>
+
+#include <initializer_list>
+
+#include <TimeZone.h>
+
+#define TIME_ZONE_SECONDS_PER_DAY 86400L
+
+// default DST rules, if the TZ string has a DST name but no rules (same as glibc and newlib)
+#define TIME_ZONE_DEFAULT_DST_START_MONTH 3
+#define TIME_ZONE_DEFAULT_DST_START_WEEK 2
+#define TIME_ZONE_DEFAULT_DST_END_MONTH 11
+#define TIME_ZONE_DEFAULT_DST_END_WEEK 1
+
+#define TIME_ZONE_MAX_TIME ((time_t) (sizeof(time_t) == 8 ? INT64_MAX : INT32_MAX))
+#define TIME_ZONE_MIN_TIME ((time_t) (sizeof(time_t) == 8 ? INT64_MIN : INT32_MIN))
+
+// days since 1970-01-01 of the given date in the proleptic Gregorian calendar (month 1-12)
+static int64_t daysFromCivil(int32_t year, uint8_t month, uint8_t day) {
+    year -= month <= 2;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t year_of_era = year - era * 400;
+    uint32_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return (int64_t) era * 146097 + day_of_era - 719468;
+}
+
+static int32_t yearFromDays(int64_t days) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t day_of_era = days - era * 146097;
+    uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    uint32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    uint32_t mp = (5 * day_of_year + 2) / 153;
+    return year_of_era + era * 400 + (mp >= 10);
+}
+
+static bool isLeapYear(int32_t year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int64_t floorDiv(int64_t a, int64_t b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+static const char *parseName(const char *p) {
+    if (*p == '<') {
+        // quoted name, e.g. "<+03>"
+        const char *end = strchr(p, '>');
+        return end && end - p - 1 >= 3 ? end + 1 : nullptr;
+    }
+    const char *start = p;
+    while (isalpha((unsigned char) *p)) {
+        p++;
+    }
+    return p - start >= 3 ? p : nullptr;
+}
+
+static const char *parseNumber(const char *p, int32_t &value, int32_t max) {
+    if (!isdigit((unsigned char) *p)) {
+        return nullptr;
+    }
+    value = 0;
+    while (isdigit((unsigned char) *p)) {
+        value = value * 10 + (*p++ - '0');
+        if (value > max) {
+            return nullptr;
+        }
+    }
+    return p;
+}
+
+// parses [+|-]hh[:mm[:ss]] into seconds
+static const char *parseTime(const char *p, int32_t &seconds) {
+    bool negative = *p == '-';
+    if (*p == '+' || *p == '-') {
+        p++;
+    }
+    int32_t hours, minutes = 0, secs = 0;
+    if (!(p = parseNumber(p, hours, 167))) {
+        return nullptr;
+    }
+    if (*p == ':' && !(p = parseNumber(p + 1, minutes, 59))) {
+        return nullptr;
+    }
+    if (*p == ':' && !(p = parseNumber(p + 1, secs, 59))) {
+        return nullptr;
+    }
+    seconds = hours * 3600 + minutes * 60 + secs;
+    if (negative) {
+        seconds = -seconds;
+    }
+    return p;
+}
+
+TimeZone::TimeZone()
+    : _tz(""), _valid(true), _std_offset(0), _has_dst(false), _dst_offset(0), _dst_start(), _dst_end(), _cache_valid(false), _cache_start(0), _cache_end(0),
+      _cache_offset(0), _cache_dst(false), _day_valid(false), _day_start(0), _day() {
+}
+
+bool TimeZone::set(const char *tz) {
+    if (!tz) {
+        tz = "";
+    }
+    if (!strncmp(tz, _tz, sizeof(_tz))) {
+        return _valid;
+    }
+    strncpy(_tz, tz, sizeof(_tz) - 1);
+    _tz[sizeof(_tz) - 1] = 0;
+
+    _cache_valid = false;
+    _valid = _parse(_tz);
+    if (!_valid) {
+        _std_offset = 0;
+        _has_dst = false;
+    }
+    return _valid;
+}
+
+int32_t TimeZone::getOffset(time_t time, bool *dst) {
+    if (!_cache_valid || time < _cache_start || time >= _cache_end) {
+        _updateCache(time);
+    }
+    if (dst) {
+        *dst = _cache_dst;
+    }
+    return _cache_offset;
+}
+
+void TimeZone::toLocal(time_t time, tm &local) {
+    bool dst;
+    time_t local_time = time + getOffset(time, &dst);
+
+    if (!_day_valid || local_time < _day_start || local_time >= _day_start + TIME_ZONE_SECONDS_PER_DAY) {
+        int64_t days = floorDiv(local_time, TIME_ZONE_SECONDS_PER_DAY);
+        _day_start = days * TIME_ZONE_SECONDS_PER_DAY;
+        gmtime_r(&_day_start, &_day);
+        _day_valid = true;
+    }
+
+    int32_t seconds = local_time - _day_start;
+    local = _day;
+    local.tm_hour = seconds / 3600;
+    local.tm_min = seconds / 60 % 60;
+    local.tm_sec = seconds % 60;
+    local.tm_isdst = dst;
+}
+
+time_t TimeZone::getNextTransition(time_t time) {
+    getOffset(time);
+    return _cache_end;
+}
+
+bool TimeZone::_parse(const char *tz) {
+    const char *p = tz;
+
+    if (!*p) {
+        _std_offset = 0;
+        _has_dst = false;
+        return true;
+    }
+
+    // POSIX offsets are west of UTC, stored offsets are east of UTC
+    int32_t offset;
+    if (!(p = parseName(p)) || !(p = parseTime(p, offset))) {
+        return false;
+    }
+    _std_offset = -offset;
+
+    _has_dst = *p != 0;
+    if (!_has_dst) {
+        return true;
+    }
+
+    if (!(p = parseName(p))) {
+        return false;
+    }
+    _dst_offset = _std_offset + 3600;
+    if (*p && *p != ',') {
+        if (!(p = parseTime(p, offset))) {
+            return false;
+        }
+        _dst_offset = -offset;
+    }
+
+    if (!*p) {
+        _dst_start = { Rule::_TIME_ZONE_RULE_MONTH_WEEK_DAY, 0, TIME_ZONE_DEFAULT_DST_START_MONTH, TIME_ZONE_DEFAULT_DST_START_WEEK, 7200 };
+        _dst_end = { Rule::_TIME_ZONE_RULE_MONTH_WEEK_DAY, 0, TIME_ZONE_DEFAULT_DST_END_MONTH, TIME_ZONE_DEFAULT_DST_END_WEEK, 7200 };
+        return true;
+    }
+
+    for (Rule *rule : { &_dst_start, &_dst_end }) {
+        if (*p++ != ',') {
+            return false;
+        }
+        int32_t value;
+        if (*p == 'J') {
+            rule->type = Rule::_TIME_ZONE_RULE_JULIAN;
+            if (!(p = parseNumber(p + 1, value, 365)) || value < 1) {
+                return false;
+            }
+            rule->day = value;
+        } else if (*p == 'M') {
+            int32_t week, day;
+            rule->type = Rule::_TIME_ZONE_RULE_MONTH_WEEK_DAY;
+            if (!(p = parseNumber(p + 1, value, 12)) || value < 1 || *p++ != '.' || !(p = parseNumber(p, week, 5)) || week < 1 || *p++ != '.'
+                || !(p = parseNumber(p, day, 6))) {
+                return false;
+            }
+            rule->month = value;
+            rule->week = week;
+            rule->day = day;
+        } else {
+            rule->type = Rule::_TIME_ZONE_RULE_DAY;
+            if (!(p = parseNumber(p, value, 365))) {
+                return false;
+            }
+            rule->day = value;
+        }
+
+        rule->time = 7200;
+        if (*p == '/' && !(p = parseTime(p + 1, rule->time))) {
+            return false;
+        }
+    }
+
+    return !*p;
+}
+
+void TimeZone::_updateCache(time_t time) {
+    _cache_valid = true;
+
+    if (!_has_dst) {
+        _cache_start = TIME_ZONE_MIN_TIME;
+        _cache_end = TIME_ZONE_MAX_TIME;
+        _cache_offset = _std_offset;
+        _cache_dst = false;
+        return;
+    }
+
+    // transitions of the previous, current and next year, sorted by time (rules may put the start after the end)
+    int32_t year = yearFromDays(floorDiv(time + _std_offset, TIME_ZONE_SECONDS_PER_DAY));
+    time_t transitions[6];
+    bool transitions_dst[6];
+    uint8_t count = 0;
+    for (int32_t y = year - 1; y <= year + 1; y++) {
+        for (bool dst : { true, false }) {
+            // the start time is given in standard time, the end time in daylight saving time
+            time_t transition = dst ? _getTransition(_dst_start, y, _std_offset) : _getTransition(_dst_end, y, _dst_offset);
+            uint8_t i = count++;
+            while (i > 0 && transitions[i - 1] > transition) {
+                transitions[i] = transitions[i - 1];
+                transitions_dst[i] = transitions_dst[i - 1];
+                i--;
+            }
+            transitions[i] = transition;
+            transitions_dst[i] = dst;
+        }
+    }
+
+    uint8_t i = 0;
+    while (i < count && transitions[i] <= time) {
+        i++;
+    }
+    // the first transition of the previous year is always before the time
+    _cache_start = i > 0 ? transitions[i - 1] : TIME_ZONE_MIN_TIME;
+    _cache_end = i < count ? transitions[i] : TIME_ZONE_MAX_TIME;
+    _cache_dst = i > 0 ? transitions_dst[i - 1] : !transitions_dst[0];
+    _cache_offset = _cache_dst ? _dst_offset : _std_offset;
+}
+
+time_t TimeZone::_getTransition(const Rule &rule, int32_t year, int32_t offset) {
+    int64_t year_start = daysFromCivil(year, 1, 1);
+    int64_t day;
+
+    switch (rule.type) {
+    case Rule::_TIME_ZONE_RULE_JULIAN:
+        // February 29th is never counted
+        day = rule.day - 1 + (isLeapYear(year) && rule.day >= 60);
+        break;
+    case Rule::_TIME_ZONE_RULE_DAY:
+        day = rule.day;
+        break;
+    case Rule::_TIME_ZONE_RULE_MONTH_WEEK_DAY:
+    default: {
+        static const uint8_t days_in_month[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        int64_t month_start = daysFromCivil(year, rule.month, 1);
+        // 1970-01-01 has been a Thursday
+        uint8_t first_weekday = (uint8_t) (((month_start % 7) + 11) % 7);
+        uint8_t mday = (rule.day + 7 - first_weekday) % 7 + (rule.week - 1) * 7;
+        uint8_t month_days = days_in_month[rule.month - 1] + (rule.month == 2 && isLeapYear(year));
+        // week 5 is the last week of the month
+        while (mday >= month_days) {
+            mday -= 7;
+        }
+        day = month_start - year_start + mday;
+        break;
+    }
+    }
+
+    return (year_start + day) * TIME_ZONE_SECONDS_PER_DAY + rule.time - offset;
+}
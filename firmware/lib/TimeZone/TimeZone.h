@@ -0,0 +1,68 @@
+#ifndef _TIME_ZONE_H
+#define _TIME_ZONE_H
+
+#include <inttypes.h>
+#include <time.h>
+
+#define TIME_ZONE_MAX_LENGTH 63
+
+// POSIX TZ evaluation (e.g. "CET-1CEST,M3.5.0,M10.5.0/3"), parsed once
+// the UTC offset is cached together with the interval it is valid for, so that most conversions are a single addition
+class TimeZone {
+public:
+    TimeZone();
+
+    // sets the time zone from a POSIX TZ string, nullptr or an empty string is UTC
+    // returns false if the string cannot be parsed (UTC is used then)
+    // does nothing if the string is unchanged
+    bool set(const char *tz);
+
+    // returns the offset of local time to UTC in seconds at the given time (east of UTC is positive)
+    int32_t getOffset(time_t time, bool *dst = nullptr);
+
+    // converts the time to local time, like localtime_r (tm_gmtoff and tm_zone are not set)
+    void toLocal(time_t time, tm &local);
+
+    // returns the time of the next offset change after the given time (or the maximum time_t value if there is none)
+    time_t getNextTransition(time_t time);
+
+private:
+    struct Rule {
+        enum {
+            _TIME_ZONE_RULE_JULIAN, // Jn, 1-365 without February 29th
+            _TIME_ZONE_RULE_DAY, // n, 0-365
+            _TIME_ZONE_RULE_MONTH_WEEK_DAY // Mm.w.d
+        } type;
+        uint16_t day;
+        uint8_t month;
+        uint8_t week;
+        int32_t time; // seconds since midnight local time, may be negative or beyond 24 hours
+    };
+
+    char _tz[TIME_ZONE_MAX_LENGTH + 1];
+    bool _valid;
+
+    int32_t _std_offset;
+    bool _has_dst;
+    int32_t _dst_offset;
+    Rule _dst_start;
+    Rule _dst_end;
+
+    // offset is valid from _cache_start until before _cache_end
+    bool _cache_valid;
+    time_t _cache_start;
+    time_t _cache_end;
+    int32_t _cache_offset;
+    bool _cache_dst;
+
+    // date fields of the local day starting at _day_start (local time), only the time of day is computed within that day
+    bool _day_valid;
+    time_t _day_start;
+    tm _day;
+
+    bool _parse(const char *tz);
+    void _updateCache(time_t time);
+    time_t _getTransition(const Rule &rule, int32_t year, int32_t offset);
+};
+
+#endif
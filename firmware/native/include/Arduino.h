@@ -0,0 +1,77 @@
+#ifndef _NATIVE_ARDUINO_H
+#define _NATIVE_ARDUINO_H
+
+// minimal subset of the Arduino/ESP8266 API used by the libraries, for native builds only
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define FPSTR(p) (p)
+
+#define snprintf_P snprintf
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define memcpy_P memcpy
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+
+// simulated time, only advanced by delay() and nativeAdvanceMicros()
+inline uint64_t native_micros = 0;
+
+inline void nativeAdvanceMicros(uint64_t us) {
+    native_micros += us;
+}
+
+// 32-bit like on the ESP8266, so that wrapping is simulated
+inline unsigned long micros() {
+    return (uint32_t) native_micros;
+}
+
+inline unsigned long millis() {
+    return (uint32_t) (native_micros / 1000);
+}
+
+inline uint64_t micros64() {
+    return native_micros;
+}
+
+inline void delay(unsigned long ms) {
+    nativeAdvanceMicros(ms * 1000);
+}
+
+inline void delayMicroseconds(unsigned int us) {
+    nativeAdvanceMicros(us);
+}
+
+inline void yield() {
+}
+
+class EspClass {
+public:
+    uint32_t getChipId() {
+        return 0x00c0ffee;
+    }
+
+    uint32_t getFlashChipId() {
+        return 0x001640ef;
+    }
+
+    uint32_t getCycleCount() {
+        return (uint32_t) (native_micros * getCpuFreqMHz());
+    }
+
+    uint8_t getCpuFreqMHz() {
+        return 80;
+    }
+};
+
+inline EspClass ESP;
+
+#endif
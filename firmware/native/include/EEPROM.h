@@ -0,0 +1,58 @@
+#ifndef _NATIVE_EEPROM_H
+#define _NATIVE_EEPROM_H
+
+// RAM-backed replacement for the ESP8266 EEPROM emulation, for native builds only
+
+#include <string.h>
+
+#include <Arduino.h>
+
+#define NATIVE_EEPROM_SIZE 4096
+
+class EEPROMClass {
+public:
+    EEPROMClass() {
+        memset(_data, 0xFF, sizeof(_data));
+    }
+
+    void begin(size_t size) {
+        _size = size <= sizeof(_data) ? size : sizeof(_data);
+    }
+
+    template <typename T>
+    T &get(int address, T &t) {
+        if (address >= 0 && address + sizeof(T) <= _size) {
+            memcpy(&t, _data + address, sizeof(T));
+        }
+        return t;
+    }
+
+    template <typename T>
+    const T &put(int address, const T &t) {
+        if (address >= 0 && address + sizeof(T) <= _size) {
+            memcpy(_data + address, &t, sizeof(T));
+        }
+        return t;
+    }
+
+    bool commit() {
+        return true;
+    }
+
+    bool end() {
+        _size = 0;
+        return true;
+    }
+
+    uint8_t *getDataPtr() {
+        return _data;
+    }
+
+private:
+    uint8_t _data[NATIVE_EEPROM_SIZE];
+    size_t _size = 0;
+};
+
+inline EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,51 @@
+# Compresses the static assets of the captive portal and generates a header with PROGMEM arrays and strong ETags.
+# The header is only rewritten if its content changes, to avoid needless rebuilds.
+
+import gzip
+import hashlib
+import os
+
+Import("env")
+
+ASSETS = [
+    # (source file, symbol prefix)
+    ("lib/CaptiveConfig/assets/style.css", "CAPTIVE_CONFIG_STYLE_CSS"),
+]
+
+HEADER = "lib/CaptiveConfig/CaptiveConfigAssets.h"
+
+
+def generate(project_dir):
+    lines = [
+        "// generated by scripts/gzip_assets.py, do not edit",
+        "",
+        "#ifndef _CAPTIVE_CONFIG_ASSETS_H",
+        "#define _CAPTIVE_CONFIG_ASSETS_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+    ]
+    for source, symbol in ASSETS:
+        with open(os.path.join(project_dir, source), "rb") as f:
+            # fixed mtime makes the output (and the ETag) reproducible
+            data = gzip.compress(f.read(), compresslevel=9, mtime=0)
+        etag = hashlib.sha1(data).hexdigest()[:16]
+        lines.append('#define %s_ETAG "\\"%s\\""' % (symbol, etag))
+        lines.append("const uint8_t %s_GZ[] PROGMEM = {" % symbol)
+        for i in range(0, len(data), 16):
+            lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append("#endif")
+    content = "\n".join(lines) + "\n"
+
+    header = os.path.join(project_dir, HEADER)
+    if os.path.exists(header):
+        with open(header) as f:
+            if f.read() == content:
+                return
+    with open(header, "w") as f:
+        f.write(content)
+
+
+generate(env.subst("$PROJECT_DIR"))
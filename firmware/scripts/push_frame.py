@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+# Host-side sender for PushApp frame packets (see lib/App/PushApp.h), e.g.
+#   scripts/push_frame.py 192.168.1.23 "12:34" --brightness 8
+#   scripts/push_frame.py 192.168.1.23 "8888" --count 200 --interval 0.05
+# With --count, every packet requests an acknowledgement and the round trip time from sending a frame
+# until it has been pushed to the display is reported (upper bound of the push-to-photon latency).
+
+import argparse
+import random
+import socket
+import struct
+import time
+
+PORT = 4210
+MAGIC = ord("W")
+VERSION = 1
+
+FLAG_COLON = 0x01
+FLAG_BRIGHTNESS = 0x02
+FLAG_CHARS = 0x04
+FLAG_RESET = 0x08
+FLAG_ACK = 0x10
+
+
+def encode(sequence, text, brightness=None, hold_millis=0, flags=0):
+    # "12:34" sets the colon, a "." after a character sets its dot
+    chars = []
+    dots = 0
+    for ch in text:
+        if ch == ":":
+            flags |= FLAG_COLON
+        elif ch == "." and chars:
+            dots |= 1 << (len(chars) - 1)
+        else:
+            chars.append(ch)
+    chars = (chars + [" "] * 4)[:4]
+
+    flags |= FLAG_CHARS
+    if brightness is not None:
+        flags |= FLAG_BRIGHTNESS
+    return struct.pack("<BBI4sBBBH", MAGIC, VERSION, sequence & 0xFFFFFFFF, "".join(chars).encode("ascii"), dots, flags,
+                       brightness or 0, hold_millis)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sends frames to the PushApp of a clock.")
+    parser.add_argument("host")
+    parser.add_argument("text", help="up to four characters, optionally with ':' and '.'")
+    parser.add_argument("--port", type=int, default=PORT)
+    parser.add_argument("--brightness", type=int, choices=range(16))
+    parser.add_argument("--hold", type=int, default=0, help="milliseconds until the frame is cleared, 0 to keep it")
+    parser.add_argument("--count", type=int, default=0, help="number of acknowledged frames for a latency measurement")
+    parser.add_argument("--interval", type=float, default=0.1)
+    parser.add_argument("--timeout", type=float, default=0.5)
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(args.timeout)
+    address = (args.host, args.port)
+
+    # random start with reset, so that a previous sender's sequence numbers don't matter
+    sequence = random.getrandbits(32)
+    if not args.count:
+        sock.sendto(encode(sequence, args.text, args.brightness, args.hold, FLAG_RESET), address)
+        return
+
+    latencies = []
+    lost = 0
+    for i in range(args.count):
+        flags = FLAG_ACK | (FLAG_RESET if i == 0 else 0)
+        start = time.perf_counter()
+        sock.sendto(encode(sequence, args.text, args.brightness, args.hold, flags), address)
+        try:
+            while True:
+                data = sock.recv(16)
+                if len(data) == 6 and struct.unpack("<BBI", data) == (MAGIC, ord("A"), sequence & 0xFFFFFFFF):
+                    latencies.append((time.perf_counter() - start) * 1000)
+                    break
+        except socket.timeout:
+            lost += 1
+        sequence += 1
+        time.sleep(args.interval)
+
+    if latencies:
+        latencies.sort()
+        print("frames %d, lost %d, latency ms: min %.1f, median %.1f, p95 %.1f, max %.1f" % (
+            args.count, lost, latencies[0], latencies[len(latencies) // 2], latencies[int(len(latencies) * 0.95)], latencies[-1]))
+    else:
+        print("frames %d, all lost" % args.count)
+
+
+if __name__ == "__main__":
+    main()
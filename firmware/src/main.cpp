@@ -1,27 +1,62 @@
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
 #include <coredecls.h>
+#include <sys/time.h>
 
-#include <memory>
+#include <algorithm>
 
+#include <AllocTracker.h>
+#include <BootTimeline.h>
 #include <HT16K33.h>
+#include <TwoWireI2CBus.h>
+#include <CountingI2CBus.h>
+#include <RetryingI2CBus.h>
+#include <LoopProfiler.h>
+#include <TimeDiscipline.h>
+#include <Metrics.h>
+#include <WebServerTemplateSink.h>
 #include <CaptiveConfig.h>
+#include <CaptiveConfigStore.h>
+#include <EspFlash.h>
 #include <SevenSegment.h>
 
-#include <AppController.h>
+#include <StaticAppController.h>
 #include <ClockApp.h>
 #include <BrightnessApp.h>
 #include <ScrollerApp.h>
+#include <PushApp.h>
+#include <UdpPushPacketSource.h>
 
 #define PIN_STATUS LED_BUILTIN
 #define PIN_SCL D1
 #define PIN_SDA D2
 
+// UDP port for frame packets (see scripts/push_frame.py)
+#define PUSH_APP_PORT 4210
+
 DNSServer dns_server;
 ESP8266WebServer web_server(80);
-CaptiveConfig captive_config(dns_server, web_server);
-HT16K33 display(0x70);
-AppController app_controller(display);
+EspFlash flash;
+// the store falls back to EEPROM if the filesystem area is too small (or missing) for its journals
+CaptiveConfigStore config_store(flash, EspFlash::getFsStartSector(), EspFlash::getFsSectorCount());
+CaptiveConfig captive_config(dns_server, web_server, config_store);
+TwoWireI2CBus wire_i2c_bus(Wire, PIN_SDA, PIN_SCL);
+RetryingI2CBus retrying_i2c_bus(wire_i2c_bus);
+CountingI2CBus i2c_bus(retrying_i2c_bus);
+HT16K33 display(i2c_bus, 0x70);
+UdpPushPacketSource push_source;
+
+// clock shown by the apps, disciplined by SNTP
+TimeDiscipline time_discipline;
+
+// the apps of both modes are fixed, so they are stored inline (the texts of the config mode apps are set in setup)
+StaticAppController<ScrollerApp, ScrollerApp> config_mode_apps(display, ScrollerApp("", 500), ScrollerApp("", 500));
+StaticAppController<ClockApp, BrightnessApp, PushApp> station_mode_apps(display, ClockApp(time_discipline), BrightnessApp(), PushApp(push_source));
+ClockApp &clock_app = station_mode_apps.getApp<0>();
+PushApp &push_app = station_mode_apps.getApp<2>();
+
+// apps of the current mode
+AppControllerBase *app_controller = &station_mode_apps;
 
 char ap_ssid[12];
 char ap_passphrase[9];
@@ -30,9 +65,183 @@ WiFiEventHandler got_ip;
 WiFiEventHandler connected;
 WiFiEventHandler disconnected;
 
+bool time_set = false;
+
+uint32_t wifi_connects = 0;
+
+size_t boot_timeline_printed = 0;
+
+unsigned long heap_sample_millis = 0;
+
+void handleGetBootTimeline() {
+    char buffer[BOOT_TIMELINE_FORMAT_SIZE];
+    size_t len = std::min(BootTimeline::format(buffer, sizeof(buffer)), sizeof(buffer) - 1);
+
+    web_server.setContentLength(len);
+    web_server.send(200, "text/plain", "");
+    web_server.sendContent(buffer, len);
+}
+
+void handleGetMetrics() {
+    // take a single snapshot, so that both renderings are identical
+    MetricsSnapshot snapshot;
+    uint64_t cur_micros = micros64();
+    snapshot.uptime_micros = cur_micros;
+    snapshot.free_heap = ESP.getFreeHeap();
+    snapshot.max_free_block_size = ESP.getMaxFreeBlockSize();
+    AllocTracker::sampleHeap(snapshot.free_heap, snapshot.max_free_block_size);
+    snapshot.free_heap_min = AllocTracker::getFreeHeapLowWater();
+    snapshot.max_free_block_size_min = AllocTracker::getMaxFreeBlockSizeLowWater();
+    snapshot.heap_fragmentation = ESP.getHeapFragmentation();
+    snapshot.loop_rate = app_controller->getLoopRate();
+    snapshot.i2c_transactions = i2c_bus.getTransactions();
+    snapshot.i2c_bytes = i2c_bus.getBytes();
+    snapshot.i2c_errors = i2c_bus.getErrors();
+    snapshot.i2c_retries = retrying_i2c_bus.getRetries();
+    snapshot.i2c_recoveries = retrying_i2c_bus.getRecoveries();
+    snapshot.i2c_fast_mode = retrying_i2c_bus.isFastMode();
+    const HT16K33LedStats &led_stats = display.getLedStats();
+    snapshot.led_updates = led_stats.transactions;
+    snapshot.led_bytes = led_stats.bytes;
+    snapshot.led_updates_skipped = led_stats.transactions_saved;
+    snapshot.led_bytes_saved = led_stats.bytes_saved;
+    snapshot.led_update_failures = led_stats.failures;
+    ConfigJournalStats config_store_stats = config_store.getStats();
+    snapshot.config_journal_enabled = config_store.isJournalEnabled();
+    snapshot.config_flash_writes = config_store_stats.writes;
+    snapshot.config_flash_erases = config_store_stats.erases;
+    snapshot.wifi_connected = WiFi.isConnected();
+    snapshot.wifi_rssi = WiFi.RSSI();
+    snapshot.wifi_reconnects = wifi_connects > 0 ? wifi_connects - 1 : 0;
+    const CaptiveConfigConnectStats &connect_stats = captive_config.getConnectStats();
+    snapshot.wifi_fast_connect_attempted = connect_stats.fast_connect_attempted;
+    snapshot.wifi_fast_connect_succeeded = connect_stats.fast_connect_succeeded;
+    snapshot.wifi_got_ip_millis = connect_stats.got_ip_millis;
+    snapshot.sntp_syncs = time_discipline.getSamples();
+    snapshot.sntp_last_sync_age_micros = cur_micros - time_discipline.getLastSampleMonoMicros();
+    snapshot.sntp_last_offset_micros = time_discipline.getLastOffset();
+    snapshot.sntp_spikes = time_discipline.getSpikes();
+    snapshot.time_steps = time_discipline.getSteps();
+    snapshot.time_frequency_ppb = time_discipline.getFrequencyPpb();
+    snapshot.frame_commit_errors = &app_controller->getCommitErrors();
+    snapshot.key_latencies = &app_controller->getKeyLatencies();
+    snapshot.key_events_dropped = app_controller->getDroppedKeyEvents();
+
+    // render once without output to determine the exact content length
+    TemplateWriter counter;
+    writeMetrics(counter, snapshot);
+
+    web_server.setContentLength(counter.getLength());
+    web_server.send(200, "text/plain; version=0.0.4", "");
+
+    WebServerTemplateSink sink(web_server);
+    TemplateWriter writer(&sink);
+    writeMetrics(writer, snapshot);
+    writer.flush();
+}
+
+void printBootTimeline() {
+    // print events recorded since the last call
+    if (BootTimeline::getCount() > boot_timeline_printed) {
+        char buffer[BOOT_TIMELINE_FORMAT_SIZE];
+        size_t len = std::min(BootTimeline::format(buffer, sizeof(buffer), boot_timeline_printed), sizeof(buffer) - 1);
+        Serial.write(buffer, len);
+        boot_timeline_printed = BootTimeline::getCount();
+    }
+}
+
+void sampleHeap() {
+    // the largest free block is determined by walking the heap, so only sample once per second
+    unsigned long cur_millis = millis();
+    if (cur_millis - heap_sample_millis >= 1000) {
+        AllocTracker::sampleHeap(ESP.getFreeHeap(), ESP.getMaxFreeBlockSize());
+        heap_sample_millis = cur_millis;
+    }
+}
+
+void startConfigModeApps() {
+    char ap_ssid_scroller[16];
+    snprintf_P(ap_ssid_scroller, sizeof(ap_ssid_scroller), PSTR("- %s -"), ap_ssid);
+    config_mode_apps.getApp<0>().setText(ap_ssid_scroller);
+
+    char ap_passphrase_scroller[13];
+    snprintf_P(ap_passphrase_scroller, sizeof(ap_passphrase_scroller), PSTR("- %s -"), ap_passphrase);
+    config_mode_apps.getApp<1>().setText(ap_passphrase_scroller);
+
+    config_mode_apps.begin();
+    app_controller = &config_mode_apps;
+}
+
+void startStationModeApps() {
+    // the station has just been started if config mode has been left, so it is usually not connected yet
+    clock_app.setTimeTrailingDot(WiFi.isConnected());
+    if (time_set) {
+        clock_app.notifyTimeSet();
+    }
+
+    push_source.begin(PUSH_APP_PORT);
+
+    station_mode_apps.begin();
+    app_controller = &station_mode_apps;
+}
+
+#ifdef LOOP_PROFILER
+void handleGetLoopProfile() {
+    // line by line, to keep the buffer small
+    char buffer[LOOP_PROFILER_LINE_SIZE];
+    web_server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    web_server.send(200, "text/plain", "");
+    size_t len;
+    for (size_t i = 0; (len = LoopProfiler::formatLine(i, buffer, sizeof(buffer))) > 0; i++) {
+        web_server.sendContent(buffer, std::min(len, sizeof(buffer) - 1));
+    }
+    web_server.sendContent("");
+
+    if (web_server.hasArg(F("reset"))) {
+        LoopProfiler::reset();
+    }
+}
+
+void printLoopProfile() {
+    // dump on any input
+    if (Serial.available() > 0) {
+        while (Serial.read() >= 0);
+        char buffer[LOOP_PROFILER_LINE_SIZE];
+        size_t len;
+        for (size_t i = 0; (len = LoopProfiler::formatLine(i, buffer, sizeof(buffer))) > 0; i++) {
+            Serial.write(buffer, std::min(len, sizeof(buffer) - 1));
+        }
+    }
+}
+#endif
+
+#ifdef ALLOC_TRACKER
+void handleGetAllocations() {
+    // line by line, to keep the buffer small
+    char buffer[ALLOC_TRACKER_LINE_SIZE];
+    web_server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    web_server.send(200, "text/plain", "");
+    size_t len;
+    for (size_t i = 0; (len = AllocTracker::formatLine(i, buffer, sizeof(buffer))) > 0; i++) {
+        web_server.sendContent(buffer, std::min(len, sizeof(buffer) - 1));
+    }
+    web_server.sendContent("");
+
+    if (web_server.hasArg(F("reset"))) {
+        AllocTracker::reset();
+    }
+}
+#endif
+
 void setup() {
+    BootTimeline::mark(PSTR("setup"));
+
+    Serial.begin(115200);
+
     Wire.begin(PIN_SDA, PIN_SCL);
-    Wire.setClock(100000);
+    // HT16K33 supports fast mode, the bus falls back to 100 kHz on errors
+    retrying_i2c_bus.begin(true);
+    BootTimeline::mark(PSTR("wire"));
 
     display.begin();
 
@@ -41,48 +250,92 @@ void setup() {
     snprintf_P(ap_ssid, sizeof(ap_ssid), PSTR("CL-%08u"), ESP.getChipId());
     snprintf_P(ap_passphrase, sizeof(ap_passphrase), PSTR("%08u"), (ESP.getChipId() ^ ESP.getFlashChipId()) % 100000000U);
 
-    captive_config.begin(ap_ssid, ap_passphrase, force_config_mode);
+    // configure time stuff when we got an IP
+    got_ip = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP &event) {
+        captive_config.applyTimeConfig();
+    });
 
-    if (captive_config.isConfigMode()) {
-        char ap_ssid_scroller[16];
-        snprintf_P(ap_ssid_scroller, sizeof(ap_ssid_scroller), PSTR("- %s -"), ap_ssid);
-        auto ap_ssid_scroller_app = std::make_shared<ScrollerApp>(ap_ssid_scroller, 500);
+    // show trailing dot in clock app when WiFi is connected
+    connected = WiFi.onStationModeConnected([](const WiFiEventStationModeConnected &event) {
+        wifi_connects++;
+        clock_app.setTimeTrailingDot(true);
+    });
+    disconnected = WiFi.onStationModeDisconnected([](const WiFiEventStationModeDisconnected &event) {
+        clock_app.setTimeTrailingDot(false);
+    });
 
-        char ap_passphrase_scroller[13];
-        snprintf_P(ap_passphrase_scroller, sizeof(ap_passphrase_scroller), PSTR("- %s -"), ap_passphrase);
-        auto ap_passphrase_scroller_app = std::make_shared<ScrollerApp>(ap_passphrase_scroller, 500);
+    // show time as soon as it is set (which is only done by SNTP here)
+    settimeofday_cb([] {
+        // SNTP has just stepped the system time, use it as sample for the disciplined clock
+        timeval now;
+        gettimeofday(&now, nullptr);
+        time_discipline.addSample(micros64(), (int64_t) now.tv_sec * 1000000 + now.tv_usec);
 
-        app_controller.addApp(ap_ssid_scroller_app);
-        app_controller.addApp(ap_passphrase_scroller_app);
-    } else {
-        // configure time stuff when we got an IP
-        got_ip = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP &event) {
-            const CaptiveConfigData &data = captive_config.getData();
-            configTime(data.tz, data.sntp_server[0], data.sntp_server[1], data.sntp_server[2]);
-        });
+        time_set = true;
+        clock_app.notifyTimeSet();
+    });
 
-        auto clock_app = std::make_shared<ClockApp>();
+    // diagnostics are available over HTTP in both modes, and stay available when config mode is left
+    web_server.on(F("/boot"), HTTP_GET, handleGetBootTimeline);
+    web_server.on(F("/metrics"), HTTP_GET, handleGetMetrics);
+#ifdef LOOP_PROFILER
+    web_server.on(F("/profile"), HTTP_GET, handleGetLoopProfile);
+#endif
+#ifdef ALLOC_TRACKER
+    web_server.on(F("/allocs"), HTTP_GET, handleGetAllocations);
+#endif
 
-        // show trailing dot in clock app when WiFi is connected
-        connected = WiFi.onStationModeConnected([clock_app](const WiFiEventStationModeConnected &event) {
-            clock_app->setTimeTrailingDot(true);
-        });
-        disconnected = WiFi.onStationModeDisconnected([clock_app](const WiFiEventStationModeDisconnected &event) {
-            clock_app->setTimeTrailingDot(false);
-        });
+    captive_config.begin(ap_ssid, ap_passphrase, force_config_mode);
+
+    if (captive_config.isConfigMode()) {
+        startConfigModeApps();
 
-        // show time as soon as it is set (which is only done by SNTP here)
-        settimeofday_cb([clock_app] {
-            clock_app->notifyTimeSet();
+        // switch to the clock when the configuration has been applied, instead of restarting
+        captive_config.onConfigModeLeft([] {
+            startStationModeApps();
         });
+    } else {
+        startStationModeApps();
 
-        app_controller.addApp(clock_app);
-        app_controller.addApp(std::make_shared<BrightnessApp>());
+        // the captive portal starts the web server in config mode
+        web_server.begin();
     }
+
+    BootTimeline::mark(PSTR("setup done"));
 }
 
 void loop() {
+    LOOP_PROFILER_START(captive_config_start);
     captive_config.doLoop();
+    LOOP_PROFILER_STOP(captive_config_start, LOOP_PROFILER_CAPTIVE_CONFIG);
+    if (!captive_config.isConfigMode()) {
+        web_server.handleClient();
+    }
 
-    app_controller.update();
+    // frame packets are also received while another app is shown, so that they don't queue up
+    // this also sends the acknowledgement of the frame shown by the last update, PushApp::update doesn't do network I/O
+    if (app_controller == &station_mode_apps) {
+        push_app.receive();
+    }
+
+    // the network is serviced above, everything below must not allocate (see lib/AllocTracker)
+    ALLOC_TRACKER_CHECK(true);
+
+    app_controller->update();
+
+    printBootTimeline();
+    sampleHeap();
+
+#ifdef LOOP_PROFILER
+    LoopProfiler::recordI2C(i2c_bus.getTransactions(), i2c_bus.getBytes());
+    printLoopProfile();
+#endif
+
+    ALLOC_TRACKER_CHECK(false);
+
+    // sleep until the next deadline, delay() yields to the WiFi stack
+    unsigned long idle_millis = std::min(captive_config.getIdleMillis(), app_controller->getIdleMillis());
+    if (idle_millis > 0) {
+        delay(idle_millis);
+    }
 }
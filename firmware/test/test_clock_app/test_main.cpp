@@ -0,0 +1,177 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <ClockApp.h>
+#include <TimeDiscipline.h>
+
+// 2024-03-30 22:58:30 UTC, shortly before local midnight and the start of DST (01:00 UTC) in CET
+#define START_MICROS 1711839510000000LL
+
+class NullDisplay : public AppDisplayInterface {
+public:
+    virtual void setBrightness(uint8_t brightness) override {
+    }
+
+    virtual void overrideBrightness(uint8_t brightness) override {
+    }
+};
+
+enum ReferenceMode {
+    REFERENCE_MODE_TIME,
+    REFERENCE_MODE_DATE,
+    REFERENCE_MODE_SECONDS
+};
+
+static TimeDiscipline *discipline;
+static ClockApp *app;
+static NullDisplay display;
+
+// deterministic pseudo-random numbers (LCG), so that failures are reproducible
+static uint32_t random_state;
+
+static uint32_t nextRandom() {
+    random_state = random_state * 1664525 + 1013904223;
+    return random_state >> 8;
+}
+
+// renders like ClockApp did before the digits were cached (localtime_r and snprintf for every frame)
+static Frame renderReference(int64_t time_micros, ReferenceMode mode, bool blinking_colon, bool trailing_dot) {
+    time_t time = time_micros / 1000000;
+    bool first_half = time_micros % 1000000 < 500000;
+    tm local;
+    localtime_r(&time, &local);
+
+    // larger than needed, so that the compiler doesn't warn about truncation
+    char chars[24] = "    ";
+    bool dots[4] = { false, false, false, false };
+    bool colon = false;
+    switch (mode) {
+    case REFERENCE_MODE_TIME:
+        snprintf(chars, sizeof(chars), "%2d%02d", local.tm_hour, local.tm_min);
+        colon = !blinking_colon || first_half;
+        dots[3] = trailing_dot;
+        break;
+    case REFERENCE_MODE_DATE:
+        snprintf(chars, sizeof(chars), "%02d%02d", local.tm_mday, local.tm_mon + 1);
+        dots[1] = true;
+        dots[3] = true;
+        break;
+    case REFERENCE_MODE_SECONDS:
+        snprintf(chars, sizeof(chars), "  %02d", local.tm_sec);
+        colon = first_half;
+        break;
+    }
+
+    Frame frame;
+    frame.clear();
+    for (uint8_t i = 0; i < 4; i++) {
+        frame.setChar(i, chars[i], dots[i]);
+    }
+    frame.colon = colon;
+    return frame;
+}
+
+static void assertFrame(const Frame &expected, const Frame &actual, int64_t time_micros) {
+    char message[64];
+    snprintf(message, sizeof(message), "at %lld", (long long) time_micros);
+    TEST_ASSERT_EQUAL_MEMORY(expected.glyphs, actual.glyphs, sizeof(expected.glyphs));
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(expected.dots, actual.dots, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.colon, actual.colon, message);
+}
+
+// updates the app, and checks the current and the scheduled frame against the reference
+static void assertUpdate(ReferenceMode mode, bool blinking_colon, bool trailing_dot) {
+    Frame previous = app->getFrame();
+    bool changed = app->update(display);
+
+    int64_t time_micros = discipline->getTime(micros64());
+    assertFrame(renderReference(time_micros, mode, blinking_colon, trailing_dot), app->getFrame(), time_micros);
+    TEST_ASSERT_EQUAL(previous != app->getFrame(), changed);
+
+    const Frame *scheduled;
+    unsigned long commit_micros;
+    TEST_ASSERT_TRUE(app->getScheduledFrame(scheduled, commit_micros));
+    int64_t next_micros = (time_micros / 500000 + 1) * 500000;
+    assertFrame(renderReference(next_micros, mode, blinking_colon, trailing_dot), *scheduled, next_micros);
+    TEST_ASSERT_EQUAL_UINT64((unsigned long) discipline->getMonoTime(next_micros, micros64()), commit_micros);
+}
+
+void setUp() {
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+    discipline = new TimeDiscipline();
+    discipline->addSample(micros64(), START_MICROS);
+    app = new ClockApp(*discipline);
+    app->notifyTimeSet();
+    random_state = 1;
+}
+
+void tearDown() {
+    delete app;
+    delete discipline;
+}
+
+void test_time_not_set() {
+    ClockApp not_set(*discipline);
+    not_set.update(display);
+    const Frame &frame = not_set.getFrame();
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_HEX8(SevenSegment.getBits(' '), frame.glyphs[i]);
+    }
+}
+
+void test_matches_reference() {
+    // across local midnight and the start of DST, with random update intervals, modes, colon settings and trailing dots
+    ReferenceMode mode = REFERENCE_MODE_TIME;
+    bool blinking_colon = true;
+    bool trailing_dot = false;
+    while (discipline->getTime(micros64()) < START_MICROS + 7500 * 1000000LL) {
+        nativeAdvanceMicros(1 + nextRandom() % 700000);
+        switch (nextRandom() % 400) {
+        case 0:
+            app->handleKeyRight();
+            mode = (ReferenceMode) ((mode + 1) % 3);
+            break;
+        case 1:
+            app->handleKeyLeft();
+            blinking_colon = mode == REFERENCE_MODE_TIME ? !blinking_colon : blinking_colon;
+            break;
+        case 2:
+            trailing_dot = !trailing_dot;
+            app->setTimeTrailingDot(trailing_dot);
+            break;
+        }
+        assertUpdate(mode, blinking_colon, trailing_dot);
+    }
+}
+
+void test_time_stepped_back() {
+    // in seconds mode, so that a stale cache would show the wrong digits immediately
+    app->handleKeyRight();
+    app->handleKeyRight();
+    for (int i = 0; i < 10; i++) {
+        nativeAdvanceMicros(250000);
+        assertUpdate(REFERENCE_MODE_SECONDS, true, false);
+    }
+
+    // stepped back by 90 s (the first sample is taken for a spike), without notifyTimeSet
+    int64_t time_micros = discipline->getTime(micros64());
+    discipline->addSample(micros64(), time_micros - 90000000);
+    discipline->addSample(micros64(), time_micros - 90000000);
+    TEST_ASSERT_EQUAL_UINT32(1, discipline->getSteps());
+    for (int i = 0; i < 10; i++) {
+        assertUpdate(REFERENCE_MODE_SECONDS, true, false);
+        nativeAdvanceMicros(250000);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_time_not_set);
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_time_stepped_back);
+    return UNITY_END();
+}
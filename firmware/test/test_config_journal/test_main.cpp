@@ -0,0 +1,212 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <string.h>
+
+#include <CaptiveConfigStore.h>
+#include <ConfigJournal.h>
+#include <SimulatedFlash.h>
+
+// not a multiple of 4, so that the last chunk of the payload is padded
+struct TestPayload {
+    uint8_t data[381];
+};
+
+static void fillPayload(TestPayload &payload, uint8_t value) {
+    memset(payload.data, value, sizeof(payload.data));
+}
+
+static bool isPayload(const TestPayload &payload, uint8_t value) {
+    for (size_t i = 0; i < sizeof(payload.data); i++) {
+        if (payload.data[i] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_load_empty() {
+    SimulatedFlash flash;
+    ConfigJournal journal(flash, 1, 4, sizeof(TestPayload));
+    TestPayload payload;
+    TEST_ASSERT_FALSE(journal.load(&payload));
+}
+
+void test_append_load() {
+    SimulatedFlash flash;
+    ConfigJournal journal(flash, 1, 4, sizeof(TestPayload));
+    TestPayload payload;
+    fillPayload(payload, 1);
+    TEST_ASSERT_TRUE(journal.append(&payload));
+    fillPayload(payload, 2);
+    TEST_ASSERT_TRUE(journal.append(&payload));
+
+    ConfigJournal reloaded(flash, 1, 4, sizeof(TestPayload));
+    TEST_ASSERT_TRUE(reloaded.load(&payload));
+    TEST_ASSERT_TRUE(isPayload(payload, 2));
+}
+
+void test_append_unchanged_skips_write() {
+    SimulatedFlash flash;
+    ConfigJournal journal(flash, 1, 4, sizeof(TestPayload));
+    TestPayload payload;
+    fillPayload(payload, 1);
+    TEST_ASSERT_TRUE(journal.append(&payload));
+    uint32_t writes = flash.getWriteCount();
+    TEST_ASSERT_TRUE(journal.append(&payload));
+    TEST_ASSERT_EQUAL_UINT32(writes, flash.getWriteCount());
+}
+
+void test_wrap_spreads_erases() {
+    SimulatedFlash flash;
+    ConfigJournal journal(flash, 1, 4, sizeof(TestPayload));
+    TestPayload payload;
+    for (uint8_t i = 0; i < 200; i++) {
+        fillPayload(payload, i);
+        TEST_ASSERT_TRUE(journal.append(&payload));
+    }
+
+    // 10 slots per sector, the first sector is erased on the first append
+    TEST_ASSERT_EQUAL_UINT32(20, journal.getStats().erases);
+
+    ConfigJournal reloaded(flash, 1, 4, sizeof(TestPayload));
+    TEST_ASSERT_TRUE(reloaded.load(&payload));
+    TEST_ASSERT_TRUE(isPayload(payload, 199));
+}
+
+void test_power_loss_at_every_byte() {
+    // the appends cover all slots of the ring, including those that erase a sector
+    SimulatedFlash flash;
+    ConfigJournal journal(flash, 1, 4, sizeof(TestPayload));
+    TestPayload payload;
+    fillPayload(payload, 0);
+    TEST_ASSERT_TRUE(journal.append(&payload));
+
+    for (uint8_t i = 1; i <= 41; i++) {
+        // the record is 16 bytes of header plus the padded payload
+        for (size_t cut = 1; cut <= 16 + 384; cut++) {
+            SimulatedFlash cut_flash = flash;
+            ConfigJournal cut_journal(cut_flash, 1, 4, sizeof(TestPayload));
+            cut_flash.failAfterBytesWritten(cut);
+            fillPayload(payload, i);
+            bool appended = cut_journal.append(&payload);
+            cut_flash.restorePower();
+
+            // after reset, either the old or the new record is loaded, and the new one if append succeeded
+            ConfigJournal reset_journal(cut_flash, 1, 4, sizeof(TestPayload));
+            TEST_ASSERT_TRUE(reset_journal.load(&payload));
+            TEST_ASSERT_TRUE(isPayload(payload, i) || (!appended && isPayload(payload, i - 1)));
+
+            // the journal keeps working
+            fillPayload(payload, 0xaa);
+            TEST_ASSERT_TRUE(reset_journal.append(&payload));
+            ConfigJournal next_journal(cut_flash, 1, 4, sizeof(TestPayload));
+            TEST_ASSERT_TRUE(next_journal.load(&payload));
+            TEST_ASSERT_TRUE(isPayload(payload, 0xaa));
+        }
+
+        fillPayload(payload, i);
+        TEST_ASSERT_TRUE(journal.append(&payload));
+    }
+}
+
+void test_load_reads_newest_sector_only() {
+    SimulatedFlash flash;
+    ConfigJournal journal(flash, 1, 4, sizeof(TestPayload));
+    TestPayload payload;
+    for (uint8_t i = 0; i < 200; i++) {
+        fillPayload(payload, i);
+        TEST_ASSERT_TRUE(journal.append(&payload));
+    }
+
+    // the first header of each of the 4 sectors, a binary search over the 10 slots of the newest one,
+    // the header of its last record, and the payload in 64 byte chunks (instead of all 40 headers)
+    flash.resetCounters();
+    ConfigJournal reloaded(flash, 1, 4, sizeof(TestPayload));
+    TEST_ASSERT_TRUE(reloaded.load(&payload));
+    TEST_ASSERT_TRUE(isPayload(payload, 199));
+    TEST_ASSERT_TRUE(flash.getReadCount() <= 4 + 4 + 1 + 6);
+}
+
+void test_failed_header_write_is_retried() {
+    // at the start of a sector (the first 10 records fill the first one), and in the middle of one
+    static const uint8_t record_counts[] = { 10, 13 };
+    for (uint8_t records : record_counts) {
+        SimulatedFlash flash;
+        ConfigJournal journal(flash, 1, 4, sizeof(TestPayload));
+        TestPayload payload;
+        for (uint8_t i = 0; i < records; i++) {
+            fillPayload(payload, i);
+            TEST_ASSERT_TRUE(journal.append(&payload));
+        }
+
+        // torn header, the device keeps running
+        flash.failAfterBytesWritten(4);
+        fillPayload(payload, 0xaa);
+        TEST_ASSERT_FALSE(journal.append(&payload));
+        flash.restorePower();
+        fillPayload(payload, 0xbb);
+        TEST_ASSERT_TRUE(journal.append(&payload));
+
+        ConfigJournal reloaded(flash, 1, 4, sizeof(TestPayload));
+        TEST_ASSERT_TRUE(reloaded.load(&payload));
+        TEST_ASSERT_TRUE(isPayload(payload, 0xbb));
+    }
+}
+
+void test_store_roundtrip() {
+    SimulatedFlash flash;
+    CaptiveConfigStore store(flash, 1, CAPTIVE_CONFIG_STORE_TOTAL_SECTORS);
+    TEST_ASSERT_TRUE(store.isJournalEnabled());
+    CaptiveConfigData data = store.load();
+    strcpy(data.ssid, "network");
+    TEST_ASSERT_TRUE(store.save(data));
+
+    CaptiveConfigStore reloaded(flash, 1, CAPTIVE_CONFIG_STORE_TOTAL_SECTORS);
+    TEST_ASSERT_EQUAL_STRING("network", reloaded.load().ssid);
+    TEST_ASSERT_TRUE(store.getStats().erases > 0);
+}
+
+void test_store_falls_back_to_eeprom() {
+    // e.g. a board without a filesystem area
+    SimulatedFlash flash;
+    CaptiveConfigStore store(flash, 0, 0);
+    TEST_ASSERT_FALSE(store.isJournalEnabled());
+    CaptiveConfigData data = store.load();
+    strcpy(data.ssid, "eeprom");
+    TEST_ASSERT_TRUE(store.save(data));
+
+    CaptiveConfigNetworkCache cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.channel = 1;
+    TEST_ASSERT_FALSE(store.saveNetworkCache(cache));
+    TEST_ASSERT_FALSE(store.loadNetworkCache(cache));
+
+    CaptiveConfigStore reloaded(flash, 0, CAPTIVE_CONFIG_STORE_TOTAL_SECTORS - 1);
+    TEST_ASSERT_EQUAL_STRING("eeprom", reloaded.load().ssid);
+
+    // flash has not been touched at all
+    TEST_ASSERT_EQUAL_UINT32(0, flash.getReadCount());
+    TEST_ASSERT_EQUAL_UINT32(0, flash.getWriteCount());
+    TEST_ASSERT_EQUAL_UINT32(0, flash.getEraseCount());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_load_empty);
+    RUN_TEST(test_append_load);
+    RUN_TEST(test_append_unchanged_skips_write);
+    RUN_TEST(test_wrap_spreads_erases);
+    RUN_TEST(test_power_loss_at_every_byte);
+    RUN_TEST(test_load_reads_newest_sector_only);
+    RUN_TEST(test_failed_header_write_is_retried);
+    RUN_TEST(test_store_roundtrip);
+    RUN_TEST(test_store_falls_back_to_eeprom);
+    return UNITY_END();
+}
@@ -0,0 +1,135 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <HT16K33.h>
+#include <SimulatedHT16K33.h>
+
+static SimulatedHT16K33 *sim;
+static HT16K33 *display;
+
+void setUp() {
+    sim = new SimulatedHT16K33();
+    display = new HT16K33(*sim);
+}
+
+void tearDown() {
+    delete display;
+    delete sim;
+}
+
+void test_begin() {
+    // e.g. left over from before a software reset
+    uint8_t garbage[] = { 0x00, 0xAA, 0x55, 0xAA, 0x55 };
+    sim->write(0x70, garbage, sizeof(garbage));
+    sim->setKeyColumn(2, 0x0105);
+
+    display->begin();
+
+    TEST_ASSERT_TRUE(sim->isOscillatorOn());
+    TEST_ASSERT_TRUE(sim->isDisplayOn());
+    TEST_ASSERT_EQUAL_UINT8(HT16K33_BLINK_OFF, sim->getBlinkRate());
+    TEST_ASSERT_EQUAL_UINT8(15, sim->getBrightness());
+    for (uint8_t column = 0; column < 8; column++) {
+        TEST_ASSERT_EQUAL_HEX16(0, sim->getLedColumn(column));
+    }
+    // key memory is valid after begin
+    TEST_ASSERT_EQUAL_HEX16(0x0105, display->getKeyColumn(2));
+}
+
+void test_simulated_address_pointer() {
+    // display RAM addresses wrap around, key RAM is read with auto-increment
+    uint8_t data[] = { 0x0F, 0x12, 0x34, 0x56 };
+    TEST_ASSERT_TRUE(sim->write(0x70, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_HEX16(0x1200, sim->getLedColumn(7));
+    TEST_ASSERT_EQUAL_HEX16(0x5634, sim->getLedColumn(0));
+
+    uint8_t oscillator_on = 0x21;
+    TEST_ASSERT_TRUE(sim->write(0x70, &oscillator_on, 1));
+    sim->setKeyColumn(0, 0x1FFF);
+    sim->setKeyColumn(1, 0x0102);
+    uint8_t key_ram = 0x40;
+    uint8_t keys[4];
+    TEST_ASSERT_EQUAL(4, sim->writeRead(0x70, &key_ram, 1, keys, sizeof(keys)));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, keys[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x1F, keys[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x02, keys[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, keys[3]);
+
+    // no device at other addresses
+    TEST_ASSERT_FALSE(sim->write(0x71, data, sizeof(data)));
+    TEST_ASSERT_EQUAL(0, sim->read(0x71, keys, sizeof(keys)));
+}
+
+void test_update_leds_writes_changed_window() {
+    display->begin();
+    sim->resetCounters();
+
+    // only the changed bytes (with the address) are written
+    display->setLedColumn(3, 0x0180);
+    display->setLedColumn(5, 0x0001);
+    display->updateLeds();
+    TEST_ASSERT_EQUAL_UINT32(1, sim->getWriteTransactionCount());
+    TEST_ASSERT_EQUAL_UINT32(1 + 5, sim->getWrittenByteCount());
+    TEST_ASSERT_EQUAL_HEX16(0x0180, sim->getLedColumn(3));
+    TEST_ASSERT_EQUAL_HEX16(0x0001, sim->getLedColumn(5));
+
+    // nothing changed, nothing written
+    display->updateLeds();
+    TEST_ASSERT_EQUAL_UINT32(1, sim->getWriteTransactionCount());
+    TEST_ASSERT_EQUAL_UINT32(1, display->getLedStats().transactions_saved);
+
+    // forced updates write all of the display RAM
+    display->updateLeds(true);
+    TEST_ASSERT_EQUAL_UINT32(2, sim->getWriteTransactionCount());
+    TEST_ASSERT_EQUAL_UINT32(1 + 5 + 17, sim->getWrittenByteCount());
+
+    display->clearAllLedColumns();
+    display->updateLeds();
+    for (uint8_t column = 0; column < 8; column++) {
+        TEST_ASSERT_EQUAL_HEX16(0, sim->getLedColumn(column));
+    }
+}
+
+void test_commands_are_written_once() {
+    display->begin();
+    sim->resetCounters();
+
+    display->setBrightness(15);
+    display->setDisplayOn(true);
+    display->setBlinkRate(HT16K33_BLINK_OFF);
+    TEST_ASSERT_EQUAL_UINT32(0, sim->getWriteTransactionCount());
+
+    display->setBrightness(7);
+    display->setBlinkRate(HT16K33_BLINK_1HZ);
+    display->setDisplayOn(false);
+    TEST_ASSERT_EQUAL_UINT32(3, sim->getWriteTransactionCount());
+    TEST_ASSERT_EQUAL_UINT8(7, sim->getBrightness());
+    TEST_ASSERT_EQUAL_UINT8(HT16K33_BLINK_1HZ, sim->getBlinkRate());
+    TEST_ASSERT_FALSE(sim->isDisplayOn());
+}
+
+void test_update_keys_waits_for_key_scan() {
+    display->begin();
+    sim->resetCounters();
+
+    sim->setKeyColumn(0, 0x0002);
+    TEST_ASSERT_FALSE(display->updateKeys());
+    TEST_ASSERT_EQUAL_UINT32(0, sim->getReadTransactionCount());
+    TEST_ASSERT_EQUAL_HEX16(0, display->getKeyColumn(0));
+
+    nativeAdvanceMicros(display->getKeyScanDelay() * 1000);
+    TEST_ASSERT_EQUAL(0, display->getKeyScanDelay());
+    TEST_ASSERT_TRUE(display->updateKeys());
+    TEST_ASSERT_EQUAL_HEX16(0x0002, display->getKeyColumn(0));
+    TEST_ASSERT_TRUE(display->getKeyScanDelay() > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin);
+    RUN_TEST(test_simulated_address_pointer);
+    RUN_TEST(test_update_leds_writes_changed_window);
+    RUN_TEST(test_commands_are_written_once);
+    RUN_TEST(test_update_keys_waits_for_key_scan);
+    return UNITY_END();
+}
@@ -0,0 +1,258 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <CountingI2CBus.h>
+#include <HT16K33.h>
+#include <RetryingI2CBus.h>
+#include <SimulatedHT16K33.h>
+
+// forwards to the simulated HT16K33, and records the clock set by the retrying bus
+class ClockRecordingI2CBus : public I2CBus {
+public:
+    ClockRecordingI2CBus(I2CBus &bus) : _bus(bus), _clock(0) {
+    }
+
+    virtual bool write(uint8_t addr, const uint8_t *data, size_t num) override {
+        return _bus.write(addr, data, num);
+    }
+
+    virtual size_t read(uint8_t addr, uint8_t *data, size_t num) override {
+        return _bus.read(addr, data, num);
+    }
+
+    virtual void setClock(uint32_t frequency) override {
+        _clock = frequency;
+    }
+
+    virtual bool recover() override {
+        return _bus.recover();
+    }
+
+    uint32_t getClock() {
+        return _clock;
+    }
+
+private:
+    I2CBus &_bus;
+    uint32_t _clock;
+};
+
+static SimulatedHT16K33 *sim;
+static ClockRecordingI2CBus *clock_bus;
+static RetryingI2CBus *retrying_bus;
+static CountingI2CBus *counting_bus;
+static HT16K33 *display;
+
+// deterministic pseudo-random numbers (LCG), so that failures are reproducible
+static uint32_t random_state;
+
+static uint32_t nextRandom() {
+    random_state = random_state * 1664525 + 1013904223;
+    return random_state >> 8;
+}
+
+static void writeByte(uint8_t data) {
+    retrying_bus->write(0x70, &data, 1);
+}
+
+void setUp() {
+    sim = new SimulatedHT16K33();
+    clock_bus = new ClockRecordingI2CBus(*sim);
+    retrying_bus = new RetryingI2CBus(*clock_bus);
+    counting_bus = new CountingI2CBus(*retrying_bus);
+    display = new HT16K33(*counting_bus);
+    retrying_bus->begin(true);
+    random_state = 1;
+}
+
+void tearDown() {
+    delete display;
+    delete counting_bus;
+    delete retrying_bus;
+    delete clock_bus;
+    delete sim;
+}
+
+void test_single_error_keeps_fast_mode() {
+    sim->injectNacks(1);
+    writeByte(0x21);
+    TEST_ASSERT_TRUE(retrying_bus->isFastMode());
+    TEST_ASSERT_EQUAL_UINT32(RETRYING_I2C_BUS_FAST_MODE_CLOCK, clock_bus->getClock());
+    TEST_ASSERT_EQUAL_UINT32(1, retrying_bus->getRetries());
+    TEST_ASSERT_EQUAL_UINT32(0, retrying_bus->getFallbacks());
+
+    // errors separated by successful transactions are not consecutive
+    for (int i = 0; i < 10; i++) {
+        sim->injectNacks(RETRYING_I2C_BUS_FALLBACK_ERRORS - 1);
+        writeByte(0x21);
+    }
+    TEST_ASSERT_TRUE(retrying_bus->isFastMode());
+    TEST_ASSERT_EQUAL_UINT32(0, retrying_bus->getFailures());
+}
+
+void test_consecutive_errors_fall_back() {
+    sim->injectNacks(RETRYING_I2C_BUS_FALLBACK_ERRORS);
+    writeByte(0x21);
+    TEST_ASSERT_FALSE(retrying_bus->isFastMode());
+    TEST_ASSERT_EQUAL_UINT32(RETRYING_I2C_BUS_STANDARD_MODE_CLOCK, clock_bus->getClock());
+    TEST_ASSERT_EQUAL_UINT32(1, retrying_bus->getFallbacks());
+    TEST_ASSERT_EQUAL_UINT32(0, retrying_bus->getFailures());
+}
+
+void test_fast_mode_is_retried() {
+    sim->injectNacks(RETRYING_I2C_BUS_FALLBACK_ERRORS);
+    writeByte(0x21);
+
+    nativeAdvanceMicros((RETRYING_I2C_BUS_FAST_MODE_RETRY_MILLIS - 1) * 1000UL);
+    writeByte(0x21);
+    TEST_ASSERT_FALSE(retrying_bus->isFastMode());
+
+    nativeAdvanceMicros(1000);
+    writeByte(0x21);
+    TEST_ASSERT_TRUE(retrying_bus->isFastMode());
+    TEST_ASSERT_EQUAL_UINT32(RETRYING_I2C_BUS_FAST_MODE_CLOCK, clock_bus->getClock());
+
+    // falls back again if the errors persist
+    sim->injectNacks(RETRYING_I2C_BUS_FALLBACK_ERRORS);
+    writeByte(0x21);
+    TEST_ASSERT_FALSE(retrying_bus->isFastMode());
+    TEST_ASSERT_EQUAL_UINT32(2, retrying_bus->getFallbacks());
+}
+
+void test_standard_mode_stays() {
+    retrying_bus->begin(false);
+    sim->injectNacks(RETRYING_I2C_BUS_FALLBACK_ERRORS);
+    writeByte(0x21);
+    nativeAdvanceMicros(RETRYING_I2C_BUS_FAST_MODE_RETRY_MILLIS * 1000UL);
+    writeByte(0x21);
+    TEST_ASSERT_FALSE(retrying_bus->isFastMode());
+    TEST_ASSERT_EQUAL_UINT32(RETRYING_I2C_BUS_STANDARD_MODE_CLOCK, clock_bus->getClock());
+    TEST_ASSERT_EQUAL_UINT32(0, retrying_bus->getFallbacks());
+}
+
+void test_failure_after_all_retries() {
+    sim->injectNacks(RETRYING_I2C_BUS_RETRIES + 1);
+    writeByte(0x21);
+    TEST_ASSERT_EQUAL_UINT32(1, retrying_bus->getFailures());
+    TEST_ASSERT_EQUAL_UINT32(RETRYING_I2C_BUS_RETRIES + 1, retrying_bus->getErrors());
+    TEST_ASSERT_EQUAL_UINT32(RETRYING_I2C_BUS_RETRIES, retrying_bus->getRecoveries());
+}
+
+void test_counting_write_read() {
+    // counted on the simulated device directly, so that the failure isn't retried
+    CountingI2CBus bus(*sim);
+    uint8_t command = 0x40;
+    uint8_t data[6];
+
+    TEST_ASSERT_EQUAL(6, bus.writeRead(0x70, &command, 1, data, 6));
+    TEST_ASSERT_EQUAL_UINT32(2, bus.getTransactions());
+    TEST_ASSERT_EQUAL_UINT32(7, bus.getBytes());
+
+    // the read is not attempted if the write is not acknowledged
+    sim->setBusStuck(true);
+    TEST_ASSERT_EQUAL(0, bus.writeRead(0x70, &command, 1, data, 6));
+    TEST_ASSERT_EQUAL_UINT32(3, bus.getTransactions());
+    TEST_ASSERT_EQUAL_UINT32(1, bus.getErrors());
+}
+
+// the display driver keeps LED and key memory consistent under random NACKs, short reads and a stuck bus
+void test_ht16k33_stress() {
+    display->begin();
+
+    uint16_t columns[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    uint16_t keys[3] = { 0, 0, 0 };
+    for (int i = 0; i < 20000; i++) {
+        for (uint8_t column = 0; column < 8; column++) {
+            // change only some of the columns, so that partial writes are exercised
+            if (nextRandom() % 4 == 0) {
+                columns[column] = nextRandom();
+            }
+            display->setLedColumn(column, columns[column]);
+        }
+        if (nextRandom() % 8 == 0) {
+            uint8_t column = nextRandom() % 3;
+            keys[column] = nextRandom() & 0x1FFF;
+            sim->setKeyColumn(column, keys[column]);
+        }
+
+        // at most RETRYING_I2C_BUS_RETRIES failed attempts per transaction, so that every transaction succeeds eventually
+        switch (nextRandom() % 8) {
+        case 0:
+            sim->injectNacks(1 + nextRandom() % RETRYING_I2C_BUS_RETRIES);
+            break;
+        case 1:
+            sim->injectShortReads(1 + nextRandom() % RETRYING_I2C_BUS_RETRIES);
+            break;
+        case 2:
+            sim->setBusStuck(true);
+            break;
+        }
+
+        display->updateLeds();
+        nativeAdvanceMicros(20000);
+        display->updateKeys();
+        sim->injectNacks(0);
+        sim->injectShortReads(0);
+
+        for (uint8_t column = 0; column < 8; column++) {
+            TEST_ASSERT_EQUAL_HEX16(columns[column], sim->getLedColumn(column));
+        }
+        for (uint8_t column = 0; column < 3; column++) {
+            TEST_ASSERT_EQUAL_HEX16(keys[column], display->getKeyColumn(column));
+        }
+    }
+
+    TEST_ASSERT_TRUE(retrying_bus->getRetries() > 0);
+    TEST_ASSERT_TRUE(retrying_bus->getFallbacks() > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, retrying_bus->getFailures());
+    TEST_ASSERT_EQUAL_UINT32(0, display->getLedStats().failures);
+    TEST_ASSERT_EQUAL_UINT32(0, counting_bus->getErrors());
+    TEST_ASSERT_TRUE(sim->isDisplayOn());
+    TEST_ASSERT_EQUAL_UINT8(15, sim->getBrightness());
+}
+
+// without enough retries, failed transactions are repaired by the next update
+void test_ht16k33_recovers_after_failures() {
+    display->begin();
+
+    display->setLedColumn(3, 0x1234);
+    sim->injectNacks(RETRYING_I2C_BUS_RETRIES + 1);
+    display->updateLeds();
+    TEST_ASSERT_EQUAL_UINT32(1, display->getLedStats().failures);
+
+    display->updateLeds();
+    TEST_ASSERT_EQUAL_HEX16(0x1234, sim->getLedColumn(3));
+
+    // a failed key read keeps the previous keys
+    sim->setKeyColumn(1, 0x0042);
+    nativeAdvanceMicros(20000);
+    TEST_ASSERT_TRUE(display->updateKeys());
+    sim->setKeyColumn(1, 0);
+    sim->injectShortReads(RETRYING_I2C_BUS_RETRIES + 1);
+    nativeAdvanceMicros(20000);
+    TEST_ASSERT_FALSE(display->updateKeys());
+    TEST_ASSERT_EQUAL_HEX16(0x0042, display->getKeyColumn(1));
+    nativeAdvanceMicros(20000);
+    TEST_ASSERT_TRUE(display->updateKeys());
+    TEST_ASSERT_EQUAL_HEX16(0, display->getKeyColumn(1));
+
+    // a failed brightness command is written again on the next LED update
+    sim->injectNacks(RETRYING_I2C_BUS_RETRIES + 1);
+    display->setBrightness(3);
+    TEST_ASSERT_EQUAL_UINT8(15, sim->getBrightness());
+    display->updateLeds();
+    TEST_ASSERT_EQUAL_UINT8(3, sim->getBrightness());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_error_keeps_fast_mode);
+    RUN_TEST(test_consecutive_errors_fall_back);
+    RUN_TEST(test_fast_mode_is_retried);
+    RUN_TEST(test_standard_mode_stays);
+    RUN_TEST(test_failure_after_all_retries);
+    RUN_TEST(test_counting_write_read);
+    RUN_TEST(test_ht16k33_stress);
+    RUN_TEST(test_ht16k33_recovers_after_failures);
+    return UNITY_END();
+}
@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <KeyEvents.h>
+
+#define KEY 1
+#define KEY_MASK (1 << KEY)
+
+static KeyEventDetector *detector;
+static KeyEventQueue *queue;
+
+// samples the keys once, and advances the simulated time by one millisecond
+static void sample(uint16_t keys) {
+    detector->update(keys, micros(), *queue);
+    nativeAdvanceMicros(1000);
+}
+
+// samples the keys every millisecond for the given time
+static void hold(uint16_t keys, unsigned long duration_millis) {
+    for (unsigned long i = 0; i < duration_millis; i++) {
+        sample(keys);
+    }
+}
+
+static void assertEvent(KeyEventType type, uint16_t repeat_count, unsigned long event_micros) {
+    KeyEvent event;
+    TEST_ASSERT_TRUE(queue->pop(event));
+    TEST_ASSERT_EQUAL_UINT8(KEY, event.key);
+    TEST_ASSERT_EQUAL(type, event.type);
+    TEST_ASSERT_EQUAL_UINT16(repeat_count, event.repeat_count);
+    TEST_ASSERT_EQUAL_UINT32(event_micros, event.micros);
+}
+
+static void assertNoEvent() {
+    KeyEvent event;
+    TEST_ASSERT_FALSE(queue->pop(event));
+}
+
+void setUp() {
+    // well after the initial change time of all keys
+    nativeAdvanceMicros(1000000);
+    detector = new KeyEventDetector();
+    queue = new KeyEventQueue();
+}
+
+void tearDown() {
+    delete detector;
+    delete queue;
+}
+
+void test_bounce_during_press() {
+    unsigned long press_micros = micros();
+    sample(KEY_MASK);
+    for (int i = 0; i < 14; i++) {
+        sample(0);
+        sample(KEY_MASK);
+    }
+    hold(KEY_MASK, 100);
+    assertEvent(KEY_EVENT_PRESS, 0, press_micros);
+    assertNoEvent();
+}
+
+void test_bounce_during_release() {
+    hold(KEY_MASK, 100);
+    unsigned long release_micros = micros();
+    sample(0);
+    for (int i = 0; i < 14; i++) {
+        sample(KEY_MASK);
+        sample(0);
+    }
+    hold(0, 100);
+    assertEvent(KEY_EVENT_PRESS, 0, release_micros - 100000);
+    assertEvent(KEY_EVENT_RELEASE, 0, release_micros);
+    assertNoEvent();
+}
+
+void test_release_after_debounce_time() {
+    // a change exactly KEY_EVENTS_DEBOUNCE_MILLIS after the last one is accepted
+    unsigned long press_micros = micros();
+    hold(KEY_MASK, KEY_EVENTS_DEBOUNCE_MILLIS);
+    sample(0);
+    assertEvent(KEY_EVENT_PRESS, 0, press_micros);
+    assertEvent(KEY_EVENT_RELEASE, 0, press_micros + KEY_EVENTS_DEBOUNCE_MILLIS * 1000);
+    assertNoEvent();
+}
+
+void test_long_press_at_threshold() {
+    unsigned long press_micros = micros();
+    hold(KEY_MASK, KEY_EVENTS_LONG_PRESS_MILLIS + 1);
+    unsigned long long_press_micros = press_micros + KEY_EVENTS_LONG_PRESS_MILLIS * 1000;
+
+    KeyEvent event;
+    bool long_press = false;
+    while (queue->pop(event)) {
+        if (event.type == KEY_EVENT_LONG_PRESS) {
+            TEST_ASSERT_FALSE(long_press);
+            TEST_ASSERT_EQUAL_UINT32(long_press_micros, event.micros);
+            long_press = true;
+        }
+    }
+    TEST_ASSERT_TRUE(long_press);
+}
+
+void test_release_at_long_press_threshold() {
+    // the release is detected in the sample that would have triggered the long press
+    unsigned long press_micros = micros();
+    hold(KEY_MASK, KEY_EVENTS_LONG_PRESS_MILLIS);
+    sample(0);
+    hold(0, 100);
+
+    KeyEvent event;
+    TEST_ASSERT_TRUE(queue->pop(event));
+    TEST_ASSERT_EQUAL(KEY_EVENT_PRESS, event.type);
+    while (queue->pop(event) && event.type == KEY_EVENT_REPEAT);
+    TEST_ASSERT_EQUAL(KEY_EVENT_RELEASE, event.type);
+    TEST_ASSERT_EQUAL_UINT32(press_micros + KEY_EVENTS_LONG_PRESS_MILLIS * 1000, event.micros);
+    assertNoEvent();
+}
+
+void test_repeat_cadence() {
+    unsigned long press_micros = micros();
+    hold(KEY_MASK, 1000);
+    sample(0);
+
+    assertEvent(KEY_EVENT_PRESS, 0, press_micros);
+    // repeats at 400, 500, ..., 900 ms, the long press at 800 ms is queued before the repeat of that sample
+    for (uint16_t i = 1; i <= 6; i++) {
+        unsigned long repeat_micros = press_micros + (KEY_EVENTS_REPEAT_DELAY_MILLIS + (i - 1) * KEY_EVENTS_REPEAT_INTERVAL_MILLIS) * 1000;
+        if (i == 5) {
+            assertEvent(KEY_EVENT_LONG_PRESS, 0, repeat_micros);
+        }
+        assertEvent(KEY_EVENT_REPEAT, i, repeat_micros);
+    }
+    assertEvent(KEY_EVENT_RELEASE, 0, press_micros + 1000000);
+    assertNoEvent();
+}
+
+void test_repeat_skips_missed_repeats() {
+    unsigned long press_micros = micros();
+    sample(KEY_MASK);
+    nativeAdvanceMicros(649000);
+    sample(KEY_MASK);
+
+    // a single repeat for the late sample, counting the missed ones
+    assertEvent(KEY_EVENT_PRESS, 0, press_micros);
+    assertEvent(KEY_EVENT_REPEAT, 3, press_micros + 650000);
+    assertNoEvent();
+}
+
+void test_queue_overflow() {
+    // all keys change together, which generates more events than the queue holds
+    uint16_t all_keys = (1 << KEY_EVENTS_MAX_KEYS) - 1;
+    detector->update(all_keys, micros(), *queue);
+    nativeAdvanceMicros(KEY_EVENTS_DEBOUNCE_MILLIS * 1000);
+    detector->update(0, micros(), *queue);
+
+    TEST_ASSERT_EQUAL_UINT32(2 * KEY_EVENTS_MAX_KEYS - KEY_EVENTS_QUEUE_SIZE, queue->getDropped());
+
+    // the oldest events are kept, and the queue accepts events again after it has been drained
+    KeyEvent event;
+    for (uint8_t i = 0; i < KEY_EVENTS_QUEUE_SIZE; i++) {
+        TEST_ASSERT_TRUE(queue->pop(event));
+        TEST_ASSERT_EQUAL_UINT8(i % KEY_EVENTS_MAX_KEYS, event.key);
+        TEST_ASSERT_EQUAL(i < KEY_EVENTS_MAX_KEYS ? KEY_EVENT_PRESS : KEY_EVENT_RELEASE, event.type);
+    }
+    TEST_ASSERT_FALSE(queue->pop(event));
+    TEST_ASSERT_TRUE(queue->push(event));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bounce_during_press);
+    RUN_TEST(test_bounce_during_release);
+    RUN_TEST(test_release_after_debounce_time);
+    RUN_TEST(test_long_press_at_threshold);
+    RUN_TEST(test_release_at_long_press_threshold);
+    RUN_TEST(test_repeat_cadence);
+    RUN_TEST(test_repeat_skips_missed_repeats);
+    RUN_TEST(test_queue_overflow);
+    return UNITY_END();
+}
@@ -0,0 +1,105 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <string>
+
+#include <Metrics.h>
+#include <TemplateWriter.h>
+
+class StringSink : public TemplateSink {
+public:
+    virtual void write(const char *data, size_t len) override {
+        output.append(data, len);
+    }
+
+    std::string output;
+};
+
+static MetricsSnapshot snapshot;
+
+void setUp() {
+    snapshot = MetricsSnapshot();
+}
+
+void tearDown() {
+}
+
+static std::string render() {
+    StringSink sink;
+    TemplateWriter writer(&sink);
+    writeMetrics(writer, snapshot);
+    writer.flush();
+
+    // the content length is determined by rendering without a sink
+    TemplateWriter counter;
+    writeMetrics(counter, snapshot);
+    TEST_ASSERT_EQUAL(sink.output.size(), counter.getLength());
+
+    return sink.output;
+}
+
+static void assertContains(const std::string &output, const char *line) {
+    TEST_ASSERT_TRUE_MESSAGE(output.find(line) != std::string::npos, line);
+}
+
+static void assertNotContains(const std::string &output, const char *name) {
+    TEST_ASSERT_TRUE_MESSAGE(output.find(name) == std::string::npos, name);
+}
+
+void test_led_stats() {
+    snapshot.led_updates = 120;
+    snapshot.led_bytes = 240;
+    snapshot.led_updates_skipped = 3480;
+    snapshot.led_bytes_saved = 60960;
+    snapshot.led_update_failures = 2;
+
+    std::string output = render();
+    assertContains(output, "# TYPE wificlock_led_updates_total counter\nwificlock_led_updates_total 120\n");
+    assertContains(output, "\nwificlock_led_bytes_total 240\n");
+    assertContains(output, "\nwificlock_led_updates_skipped_total 3480\n");
+    assertContains(output, "\nwificlock_led_bytes_saved_total 60960\n");
+    assertContains(output, "\nwificlock_led_update_failures_total 2\n");
+}
+
+void test_omitted_without_value() {
+    std::string output = render();
+    assertNotContains(output, "wificlock_wifi_rssi_dbm");
+    assertNotContains(output, "wificlock_wifi_got_ip_seconds");
+    assertNotContains(output, "wificlock_sntp_last_sync_age_seconds");
+    assertNotContains(output, "wificlock_sntp_last_offset_seconds");
+    assertNotContains(output, "wificlock_time_frequency_error_ratio");
+    assertNotContains(output, "wificlock_frame_commit_error_seconds");
+    assertNotContains(output, "wificlock_key_latency_seconds");
+
+    snapshot.wifi_connected = true;
+    snapshot.wifi_rssi = -67;
+    snapshot.sntp_syncs = 2;
+    snapshot.sntp_last_offset_micros = -1500;
+    snapshot.time_frequency_ppb = -12345;
+    output = render();
+    assertContains(output, "\nwificlock_wifi_rssi_dbm -67\n");
+    assertContains(output, "\nwificlock_sntp_last_offset_seconds -0.001500\n");
+    assertContains(output, "\nwificlock_time_frequency_error_ratio -0.000012345\n");
+}
+
+void test_connect_stats() {
+    std::string output = render();
+    assertContains(output, "\nwificlock_wifi_fast_connect_attempted 0\n");
+    assertContains(output, "\nwificlock_wifi_fast_connect_succeeded 0\n");
+
+    snapshot.wifi_fast_connect_attempted = true;
+    snapshot.wifi_fast_connect_succeeded = true;
+    snapshot.wifi_got_ip_millis = 1234;
+    output = render();
+    assertContains(output, "\nwificlock_wifi_fast_connect_attempted 1\n");
+    assertContains(output, "\nwificlock_wifi_fast_connect_succeeded 1\n");
+    assertContains(output, "# TYPE wificlock_wifi_got_ip_seconds gauge\nwificlock_wifi_got_ip_seconds 1.234000\n");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_led_stats);
+    RUN_TEST(test_omitted_without_value);
+    RUN_TEST(test_connect_stats);
+    return UNITY_END();
+}
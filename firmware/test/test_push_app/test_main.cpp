@@ -0,0 +1,198 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+
+#include <App.h>
+#include <BrightnessApp.h>
+#include <HT16K33.h>
+#include <PushApp.h>
+#include <PushPacketSource.h>
+#include <SimulatedHT16K33.h>
+#include <StaticAppController.h>
+
+// holds a single packet, and records the last reply together with the sender it has been sent to
+class TestPacketSource : public PushPacketSource {
+public:
+    uint8_t packet[PUSH_APP_PACKET_SIZE];
+    size_t packet_len = 0;
+    uint8_t packet_sender = 0;
+    uint8_t received_sender = 0;
+    uint8_t kept_sender = 0;
+    uint8_t reply_data[PUSH_APP_ACK_SIZE];
+    size_t reply_len = 0;
+    uint8_t reply_sender = 0;
+
+    virtual size_t receive(uint8_t *data, size_t size) override {
+        size_t len = packet_len;
+        memcpy(data, packet, std::min(len, size));
+        packet_len = 0;
+        if (len) {
+            received_sender = packet_sender;
+        }
+        return len;
+    }
+
+    virtual void keepSender() override {
+        kept_sender = received_sender;
+    }
+
+    virtual void reply(const uint8_t *data, size_t size) override {
+        memcpy(reply_data, data, std::min(size, sizeof(reply_data)));
+        reply_len = size;
+        reply_sender = kept_sender;
+    }
+
+    void push(uint32_t sequence, const char *chars, uint8_t flags, uint8_t brightness = 0, uint8_t sender = 1) {
+        uint8_t data[PUSH_APP_PACKET_SIZE] = { PUSH_APP_MAGIC, PUSH_APP_VERSION, (uint8_t) sequence, (uint8_t) (sequence >> 8), (uint8_t) (sequence >> 16),
+            (uint8_t) (sequence >> 24), (uint8_t) chars[0], (uint8_t) chars[1], (uint8_t) chars[2], (uint8_t) chars[3], 0, (uint8_t) (flags | PUSH_APP_FLAG_CHARS),
+            brightness, 0, 0 };
+        memcpy(packet, data, sizeof(packet));
+        packet_len = sizeof(packet);
+        packet_sender = sender;
+    }
+};
+
+typedef StaticAppController<BrightnessApp, PushApp> TestController;
+
+static SimulatedHT16K33 *sim;
+static HT16K33 *display;
+static TestPacketSource *source;
+static TestController *controller;
+
+void setUp() {
+    sim = new SimulatedHT16K33();
+    display = new HT16K33(*sim);
+    display->begin();
+    source = new TestPacketSource();
+    controller = new TestController(*display, BrightnessApp(), PushApp(*source));
+    controller->begin();
+}
+
+void tearDown() {
+    delete controller;
+    delete source;
+    delete display;
+    delete sim;
+}
+
+// receives like the main loop, i.e. regardless of the app shown
+static void run(unsigned long millis) {
+    for (unsigned long i = 0; i < millis / 5; i++) {
+        nativeAdvanceMicros(5000);
+        controller->getApp<1>().receive();
+        controller->update();
+    }
+}
+
+static void pressKey(uint8_t key) {
+    sim->setKeyColumn(0, 1 << key);
+    run(100);
+    sim->setKeyColumn(0, 0);
+    run(100);
+}
+
+void test_frame() {
+    pressKey(APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_HEX16(SevenSegment.getBits('-'), sim->getLedColumn(0));
+
+    source->push(1, "12ab", PUSH_APP_FLAG_COLON | PUSH_APP_FLAG_ACK);
+    run(10);
+    TEST_ASSERT_EQUAL_HEX16(SevenSegment.getBits('1'), sim->getLedColumn(0));
+    TEST_ASSERT_EQUAL_HEX16(SevenSegment.getBits('b', true), sim->getLedColumn(3));
+    TEST_ASSERT_EQUAL_HEX16(1, sim->getLedColumn(4));
+    TEST_ASSERT_EQUAL(PUSH_APP_ACK_SIZE, source->reply_len);
+    TEST_ASSERT_EQUAL_HEX8('A', source->reply_data[1]);
+    TEST_ASSERT_EQUAL_HEX8(1, source->reply_data[2]);
+
+    // stale packets are dropped
+    source->push(1, "3456", 0);
+    run(10);
+    TEST_ASSERT_EQUAL_HEX16(SevenSegment.getBits('1'), sim->getLedColumn(0));
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getApp<1>().getStats().stale);
+}
+
+void test_ack_goes_to_requesting_sender() {
+    PushApp &app = controller->getApp<1>();
+    pressKey(APP_KEY_NEXT);
+
+    // packets received before the acknowledged frame has been shown, a malformed one and a newer one without the flag
+    source->push(5, "1234", PUSH_APP_FLAG_ACK, 0, 1);
+    app.receive();
+    source->push(6, "5678", 0, 0, 2);
+    source->packet_len = 3;
+    app.receive();
+    source->push(7, "9abc", 0, 0, 3);
+    app.receive();
+    TEST_ASSERT_EQUAL(0, source->reply_len);
+    TEST_ASSERT_EQUAL_UINT32(1, app.getStats().malformed);
+
+    run(10);
+    TEST_ASSERT_EQUAL_HEX16(SevenSegment.getBits('9'), sim->getLedColumn(0));
+    TEST_ASSERT_EQUAL(PUSH_APP_ACK_SIZE, source->reply_len);
+    TEST_ASSERT_EQUAL_UINT8(1, source->reply_sender);
+    TEST_ASSERT_EQUAL_HEX8(5, source->reply_data[2]);
+
+    // sent only once
+    source->reply_len = 0;
+    run(10);
+    TEST_ASSERT_EQUAL(0, source->reply_len);
+
+    // a stale packet with the flag doesn't request one
+    source->push(7, "def0", PUSH_APP_FLAG_ACK, 0, 4);
+    run(10);
+    TEST_ASSERT_EQUAL(0, source->reply_len);
+}
+
+void test_brightness_restored_when_left() {
+    // the default level of BrightnessApp
+    run(10);
+    TEST_ASSERT_EQUAL_UINT8(15, sim->getBrightness());
+    pressKey(APP_KEY_LEFT);
+    TEST_ASSERT_EQUAL_UINT8(8, sim->getBrightness());
+
+    pressKey(APP_KEY_NEXT);
+    source->push(1, "1234", PUSH_APP_FLAG_BRIGHTNESS, 2);
+    run(10);
+    TEST_ASSERT_EQUAL_UINT8(2, sim->getBrightness());
+
+    // leaving the app restores the level
+    pressKey(APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(8, sim->getBrightness());
+
+    // which can be changed as usual
+    pressKey(APP_KEY_LEFT);
+    TEST_ASSERT_EQUAL_UINT8(3, sim->getBrightness());
+
+    // the pushed brightness is applied again with the pushed frame
+    pressKey(APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(2, sim->getBrightness());
+    TEST_ASSERT_EQUAL_HEX16(SevenSegment.getBits('1'), sim->getLedColumn(0));
+    pressKey(APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(3, sim->getBrightness());
+}
+
+void test_brightness_received_while_hidden() {
+    source->push(1, "1234", PUSH_APP_FLAG_BRIGHTNESS, 1);
+    run(10);
+    TEST_ASSERT_EQUAL_UINT8(15, sim->getBrightness());
+
+    pressKey(APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(1, sim->getBrightness());
+
+    // also restored when leaving with a long press
+    sim->setKeyColumn(0, 1 << APP_KEY_NEXT);
+    run(KEY_EVENTS_LONG_PRESS_MILLIS + 100);
+    sim->setKeyColumn(0, 0);
+    run(100);
+    TEST_ASSERT_EQUAL_UINT8(15, sim->getBrightness());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame);
+    RUN_TEST(test_ack_goes_to_requesting_sender);
+    RUN_TEST(test_brightness_restored_when_left);
+    RUN_TEST(test_brightness_received_while_hidden);
+    return UNITY_END();
+}
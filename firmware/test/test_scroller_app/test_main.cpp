@@ -0,0 +1,133 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <App.h>
+#include <ScrollerApp.h>
+#include <SevenSegment.h>
+
+class NullDisplay : public AppDisplayInterface {
+public:
+    virtual void setBrightness(uint8_t brightness) override {
+    }
+
+    virtual void overrideBrightness(uint8_t brightness) override {
+    }
+};
+
+static NullDisplay display;
+
+static const char *const texts[] = { "", "a", "1.", ".", "12.5", "1..2", "...", "ab.c.d..e", ".1.2.3.", "- wificlock-1a2b3c -", "3.14159265358979323846" };
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+static void assertWindow(ScrollerApp &app, const char *expected, uint8_t expected_dots) {
+    Frame frame;
+    frame.clear();
+    for (uint8_t i = 0; i < 4; i++) {
+        frame.setChar(i, expected[i], (expected_dots >> i) & 1, true);
+    }
+    app.update(display);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(frame.glyphs, app.getFrame().glyphs, 4);
+    TEST_ASSERT_EQUAL_HEX8(frame.dots, app.getFrame().dots);
+}
+
+void test_dots_are_folded() {
+    ScrollerApp app("12.5", 0);
+    app.enter();
+    assertWindow(app, "1251", 0x2);
+    app.handleKeyRight();
+    assertWindow(app, "2512", 0x9);
+    app.handleKeyRight();
+    assertWindow(app, "5125", 0x4);
+    app.handleKeyRight();
+    assertWindow(app, "1251", 0x2);
+    app.handleKeyLeft();
+    assertWindow(app, "5125", 0x4);
+
+    // a second dot takes a digit of its own
+    app.setText("1..2");
+    assertWindow(app, "1 21", 0xB);
+}
+
+void test_flash_text_matches_ram_text() {
+    for (const char *text : texts) {
+        ScrollerApp ram_app(text, 0);
+        ScrollerApp flash_app("", 0);
+        flash_app.setText_P(text);
+        ram_app.enter();
+        flash_app.enter();
+
+        // forwards and backwards, across the end of the text in both directions
+        uint32_t random_state = 1;
+        for (int i = 0; i < 200; i++) {
+            TEST_ASSERT_EQUAL_MESSAGE(ram_app.update(display), flash_app.update(display), text);
+            TEST_ASSERT_TRUE_MESSAGE(ram_app.getFrame() == flash_app.getFrame(), text);
+
+            random_state = random_state * 1664525 + 1013904223;
+            if (random_state >> 31) {
+                ram_app.handleKeyRight();
+                flash_app.handleKeyRight();
+            } else {
+                ram_app.handleKeyLeft();
+                flash_app.handleKeyLeft();
+            }
+        }
+    }
+}
+
+void test_empty_text() {
+    ScrollerApp app("", 100);
+    app.enter();
+    TEST_ASSERT_FALSE(app.update(display));
+    TEST_ASSERT_EQUAL_UINT32(ULONG_MAX, app.getUpdateDelay());
+
+    // no position to move to
+    app.handleKeyLeft();
+    app.handleKeyRight();
+    TEST_ASSERT_FALSE(app.update(display));
+
+    app.setText_P("");
+    app.handleKeyLeft();
+    app.handleKeyRight();
+    TEST_ASSERT_FALSE(app.update(display));
+
+    // and still usable afterwards
+    app.setText("ab");
+    assertWindow(app, "abab", 0);
+}
+
+void test_autoscroll() {
+    ScrollerApp app("", 100, scrollerPauseAtStartTiming);
+    app.setText_P("1.23");
+    app.enter();
+    assertWindow(app, "1231", 0x9);
+    TEST_ASSERT_EQUAL_UINT32(401, app.getUpdateDelay());
+
+    nativeAdvanceMicros(401000);
+    TEST_ASSERT_EQUAL_UINT32(0, app.getUpdateDelay());
+    assertWindow(app, "2312", 0x4);
+    TEST_ASSERT_EQUAL_UINT32(101, app.getUpdateDelay());
+
+    nativeAdvanceMicros(101000);
+    assertWindow(app, "3123", 0x2);
+    nativeAdvanceMicros(101000);
+    assertWindow(app, "1231", 0x9);
+
+    // a key stops autoscrolling
+    app.handleKeyLeft();
+    assertWindow(app, "3123", 0x2);
+    TEST_ASSERT_EQUAL_UINT32(ULONG_MAX, app.getUpdateDelay());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_dots_are_folded);
+    RUN_TEST(test_flash_text_matches_ram_text);
+    RUN_TEST(test_empty_text);
+    RUN_TEST(test_autoscroll);
+    return UNITY_END();
+}
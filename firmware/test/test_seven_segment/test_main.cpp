@@ -0,0 +1,150 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <ctype.h>
+
+#include <chrono>
+
+#include <SevenSegment.h>
+
+// implementation before the glyph tables, as reference: linear search in the mappings, with tolower/toupper as case fallback
+struct reference_mapping_t {
+    char ch;
+    uint16_t bits;
+};
+
+const reference_mapping_t REFERENCE_MAPPINGS[] = {
+    { ' ', 0b00000000 },
+    { '0', 0b00111111 },
+    { '1', 0b00000110 },
+    { '2', 0b01011011 },
+    { '3', 0b01001111 },
+    { '4', 0b01100110 },
+    { '5', 0b01101101 },
+    { '6', 0b01111101 },
+    { '7', 0b00000111 },
+    { '8', 0b01111111 },
+    { '9', 0b01101111 },
+    { 'A', 0b01110111 },
+    { 'b', 0b01111100 },
+    { 'c', 0b01011000 },
+    { 'C', 0b00111001 },
+    { 'd', 0b01011110 },
+    { 'E', 0b01111001 },
+    { 'F', 0b01110001 },
+    { 'G', 0b00111101 },
+    { 'h', 0b01110100 },
+    { 'H', 0b01110110 },
+    { 'i', 0b00000100 },
+    { 'j', 0b00001100 },
+    { 'J', 0b00011110 },
+    { 'L', 0b00111000 },
+    { 'n', 0b01010100 },
+    { 'o', 0b01011100 },
+    { 'P', 0b01110011 },
+    { 'q', 0b01100111 },
+    { 'r', 0b01010000 },
+    { 'S', 0b01101101 },
+    { 't', 0b01111000 },
+    { 'u', 0b00011100 },
+    { 'y', 0b01101110 },
+    { 'Y', 0b01100110 },
+    { '-', 0b01000000 },
+    { '_', 0b00001000 },
+    { '@', 0b01111011 },
+    {   0, 0b00000000 }
+};
+
+static const reference_mapping_t *referenceFindMapping(char ch) {
+    for (const reference_mapping_t *m = &REFERENCE_MAPPINGS[0]; m->ch; m++) {
+        if (m->ch == ch) {
+            return m;
+        }
+    }
+    return nullptr;
+}
+
+static const reference_mapping_t *referenceFindMappingWithCaseFallback(char ch) {
+    const reference_mapping_t *m = referenceFindMapping(ch);
+    if (m != nullptr) {
+        return m;
+    }
+    char ch2 = tolower(ch);
+    if (ch2 == ch) {
+        ch2 = toupper(ch);
+    }
+    if (ch2 != ch) {
+        m = referenceFindMapping(ch2);
+        if (m != nullptr) {
+            return m;
+        }
+    }
+    return nullptr;
+}
+
+static uint16_t referenceGetBits(char ch, bool case_fallback, uint16_t default_bits) {
+    const reference_mapping_t *m = case_fallback ? referenceFindMappingWithCaseFallback(ch) : referenceFindMapping(ch);
+    return m != nullptr ? m->bits : default_bits;
+}
+
+// keeps the benchmark loops from being optimized away
+static volatile uint16_t benchmark_sink;
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_matches_reference() {
+    const uint16_t default_bits[] = { 0b00001000, 0xffff };
+    for (uint16_t default_value : default_bits) {
+        for (int i = 0; i < 256; i++) {
+            char ch = static_cast<char>(i);
+            char message[32];
+            snprintf(message, sizeof(message), "char 0x%02x", i);
+            TEST_ASSERT_EQUAL_HEX16_MESSAGE(referenceGetBits(ch, false, default_value), SevenSegment.getBits(ch, false, default_value), message);
+            TEST_ASSERT_EQUAL_HEX16_MESSAGE(referenceGetBits(ch, true, default_value), SevenSegment.getBits(ch, true, default_value), message);
+        }
+    }
+}
+
+void test_default_arguments() {
+    TEST_ASSERT_EQUAL_HEX16(0b01111111, SevenSegment.getBits('8'));
+    TEST_ASSERT_EQUAL_HEX16(0b00001000, SevenSegment.getBits('a'));
+    TEST_ASSERT_EQUAL_HEX16(0b01110111, SevenSegment.getBits('a', true));
+}
+
+// benchmark only, the timings are reported and not checked (they depend on the host)
+void test_benchmark() {
+    const int rounds = 20000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < 256; i++) {
+            benchmark_sink = referenceGetBits(static_cast<char>(i), true, 0b00001000);
+        }
+    }
+    auto reference_end = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < 256; i++) {
+            benchmark_sink = SevenSegment.getBits(static_cast<char>(i), true);
+        }
+    }
+    auto table_end = std::chrono::steady_clock::now();
+
+    double lookups = rounds * 256.0;
+    char message[96];
+    snprintf(message, sizeof(message), "getBits with case fallback: %.1f ns (linear search: %.1f ns)",
+        std::chrono::duration<double, std::nano>(table_end - reference_end).count() / lookups,
+        std::chrono::duration<double, std::nano>(reference_end - start).count() / lookups);
+    TEST_MESSAGE(message);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_default_arguments);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
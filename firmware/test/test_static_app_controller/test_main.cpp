@@ -0,0 +1,315 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <App.h>
+#include <AppController.h>
+#include <HT16K33.h>
+#include <KeyEvents.h>
+#include <SimulatedHT16K33.h>
+#include <StaticAppController.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+// shows its id in digit 0 and a counter (changed by the left and right keys) in digit 3
+class StubApp : public App {
+public:
+    StubApp(uint8_t id) : init_count(0), enter_count(0), update_count(0), key_event_count(0), next_key_event_count(0), _id(id), _value(0), _changed(true) {
+    }
+
+    uint32_t init_count;
+    uint32_t enter_count;
+    uint32_t update_count;
+    uint32_t key_event_count;
+    uint32_t next_key_event_count;
+
+    virtual void init(AppDisplayInterface &display) override {
+        init_count++;
+    }
+
+    virtual void enter() override {
+        enter_count++;
+        _changed = true;
+    }
+
+    virtual void handleKeyLeft() override {
+        _value--;
+        _changed = true;
+    }
+
+    virtual void handleKeyRight() override {
+        _value++;
+        _changed = true;
+    }
+
+    virtual void handleKeyEvent(const KeyEvent &event) override {
+        key_event_count++;
+        if (event.key == APP_KEY_NEXT) {
+            next_key_event_count++;
+        }
+        App::handleKeyEvent(event);
+    }
+
+    virtual unsigned long getUpdateDelay() override {
+        return ULONG_MAX;
+    }
+
+    virtual bool update(AppDisplayInterface &display) override {
+        update_count++;
+        _frame.clear();
+        _frame.glyphs[0] = _id;
+        _frame.glyphs[3] = _value;
+        bool changed = _changed;
+        _changed = false;
+        return changed;
+    }
+
+    void schedule(uint8_t glyph, unsigned long commit_micros) {
+        Frame frame = _frame;
+        frame.glyphs[1] = glyph;
+        scheduleFrame(frame, commit_micros);
+    }
+
+private:
+    uint8_t _id;
+    uint8_t _value;
+    bool _changed;
+};
+
+typedef StaticAppController<StubApp, StubApp, StubApp> TestController;
+
+static SimulatedHT16K33 *sim;
+static HT16K33 *display;
+static TestController *controller;
+
+void setUp() {
+    sim = new SimulatedHT16K33();
+    display = new HT16K33(*sim);
+    display->begin();
+    controller = new TestController(*display, StubApp(1), StubApp(2), StubApp(3));
+    controller->begin();
+}
+
+void tearDown() {
+    delete controller;
+    delete display;
+    delete sim;
+}
+
+// calls update every 5ms, like the main loop would (key scanning happens every 20ms)
+static void run(AppControllerBase &app_controller, unsigned long millis) {
+    for (unsigned long i = 0; i < millis / 5; i++) {
+        nativeAdvanceMicros(5000);
+        app_controller.update();
+    }
+}
+
+static void pressKey(AppControllerBase &app_controller, uint8_t key, unsigned long hold_millis = 100) {
+    sim->setKeyColumn(0, 1 << key);
+    run(app_controller, hold_millis);
+    sim->setKeyColumn(0, 0);
+    run(app_controller, 100);
+}
+
+static volatile unsigned long benchmark_sink;
+
+static uint8_t shownAppId() {
+    return sim->getLedColumn(0);
+}
+
+void test_begin() {
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getApp<0>().init_count);
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getApp<1>().init_count);
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getApp<2>().init_count);
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getApp<0>().enter_count);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<1>().enter_count);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<2>().enter_count);
+
+    // the first update shows the first app
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getIdleMillis());
+    run(*controller, 5);
+    TEST_ASSERT_EQUAL_UINT8(1, shownAppId());
+}
+
+void test_update_current_app_only() {
+    run(*controller, 100);
+    TEST_ASSERT_EQUAL_UINT32(20, controller->getApp<0>().update_count);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<1>().update_count);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<2>().update_count);
+}
+
+void test_next_wraps_around() {
+    run(*controller, 100);
+
+    pressKey(*controller, APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(2, shownAppId());
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getApp<1>().enter_count);
+
+    pressKey(*controller, APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(3, shownAppId());
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getApp<2>().enter_count);
+
+    pressKey(*controller, APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(1, shownAppId());
+    TEST_ASSERT_EQUAL_UINT32(2, controller->getApp<0>().enter_count);
+
+    // the next key is handled by the controller only
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<0>().next_key_event_count);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<1>().next_key_event_count);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<2>().next_key_event_count);
+}
+
+void test_long_press_goes_to_first_app() {
+    run(*controller, 100);
+    pressKey(*controller, APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(2, shownAppId());
+
+    // the press switches to the next app, the long press to the first one
+    pressKey(*controller, APP_KEY_NEXT, KEY_EVENTS_LONG_PRESS_MILLIS + 200);
+    TEST_ASSERT_EQUAL_UINT8(1, shownAppId());
+    TEST_ASSERT_EQUAL_UINT32(1, controller->getApp<2>().enter_count);
+    TEST_ASSERT_EQUAL_UINT32(2, controller->getApp<0>().enter_count);
+
+    // from the first app, the press enters the second one, and the repeats that follow the long press are ignored
+    pressKey(*controller, APP_KEY_NEXT, 2 * KEY_EVENTS_LONG_PRESS_MILLIS);
+    TEST_ASSERT_EQUAL_UINT8(1, shownAppId());
+    TEST_ASSERT_EQUAL_UINT32(2, controller->getApp<1>().enter_count);
+    TEST_ASSERT_EQUAL_UINT32(3, controller->getApp<0>().enter_count);
+}
+
+void test_keys_go_to_current_app() {
+    run(*controller, 100);
+    pressKey(*controller, APP_KEY_NEXT);
+
+    pressKey(*controller, APP_KEY_RIGHT);
+    pressKey(*controller, APP_KEY_RIGHT);
+    pressKey(*controller, APP_KEY_LEFT);
+    TEST_ASSERT_EQUAL_UINT8(2, shownAppId());
+    TEST_ASSERT_EQUAL_HEX16(1, sim->getLedColumn(3));
+
+    // press and release of each key
+    TEST_ASSERT_EQUAL_UINT32(6, controller->getApp<1>().key_event_count);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<0>().key_event_count);
+    TEST_ASSERT_EQUAL_UINT32(0, controller->getApp<2>().key_event_count);
+
+    // the state of an app is kept while another app is shown
+    pressKey(*controller, APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_HEX16(0, sim->getLedColumn(3));
+    pressKey(*controller, APP_KEY_NEXT);
+    pressKey(*controller, APP_KEY_NEXT);
+    TEST_ASSERT_EQUAL_UINT8(2, shownAppId());
+    TEST_ASSERT_EQUAL_HEX16(1, sim->getLedColumn(3));
+}
+
+void test_scheduled_frame() {
+    run(*controller, 100);
+
+    unsigned long commit_micros = micros() + 10000;
+    controller->getApp<0>().schedule(0x7F, commit_micros);
+
+    // woken up before the frame is due (or for the next key scan), and spinning until it is
+    TEST_ASSERT_EQUAL_UINT32(std::min(display->getKeyScanDelay(), (10000UL - APP_CONTROLLER_COMMIT_SPIN_MICROS) / 1000), controller->getIdleMillis());
+    run(*controller, 5);
+    TEST_ASSERT_EQUAL_HEX16(0, sim->getLedColumn(1));
+    run(*controller, 5);
+    TEST_ASSERT_EQUAL_HEX16(0x7F, sim->getLedColumn(1));
+    TEST_ASSERT_EQUAL_UINT32(commit_micros, micros());
+
+    // frames of other apps are not committed
+    controller->getApp<1>().schedule(0x3F, micros());
+    run(*controller, 5);
+    TEST_ASSERT_EQUAL_HEX16(0x7F, sim->getLedColumn(1));
+}
+
+void test_same_output_as_app_controller() {
+    SimulatedHT16K33 app_controller_sim;
+    HT16K33 app_controller_display(app_controller_sim);
+    app_controller_display.begin();
+    AppController app_controller(app_controller_display);
+    for (uint8_t id = 1; id <= 3; id++) {
+        app_controller.addApp(std::make_shared<StubApp>(id));
+    }
+
+    static const uint8_t keys[] = { APP_KEY_RIGHT, APP_KEY_NEXT, APP_KEY_LEFT, APP_KEY_NEXT, APP_KEY_NEXT, APP_KEY_RIGHT, APP_KEY_NEXT, APP_KEY_LEFT };
+    for (size_t i = 0; i < sizeof(keys); i++) {
+        // press and release, the key scans of the two chips are not in phase, so the output is compared after each key
+        for (int step = 0; step < 2; step++) {
+            uint16_t key_bits = step ? 0 : 1 << keys[i];
+            sim->setKeyColumn(0, key_bits);
+            app_controller_sim.setKeyColumn(0, key_bits);
+            for (int j = 0; j < 20; j++) {
+                nativeAdvanceMicros(5000);
+                controller->update();
+                app_controller.update();
+            }
+        }
+        for (uint8_t column = 0; column < 8; column++) {
+            TEST_ASSERT_EQUAL_HEX16(app_controller_sim.getLedColumn(column), sim->getLedColumn(column));
+        }
+    }
+}
+
+void test_app_controller_limit() {
+    AppController app_controller(*display);
+    std::shared_ptr<StubApp> first_app = std::make_shared<StubApp>(1);
+    TEST_ASSERT_TRUE(app_controller.addApp(first_app));
+    for (uint8_t id = 2; id <= APP_CONTROLLER_MAX_APPS; id++) {
+        TEST_ASSERT_TRUE(app_controller.addApp(std::make_shared<StubApp>(id)));
+    }
+    std::shared_ptr<StubApp> extra_app = std::make_shared<StubApp>(APP_CONTROLLER_MAX_APPS + 1);
+    TEST_ASSERT_FALSE(app_controller.addApp(extra_app));
+    TEST_ASSERT_EQUAL_UINT32(0, extra_app->init_count);
+
+    // the extra app is never shown
+    for (uint8_t i = 0; i <= APP_CONTROLLER_MAX_APPS; i++) {
+        pressKey(app_controller, APP_KEY_NEXT);
+        TEST_ASSERT_EQUAL_UINT8((i + 1) % APP_CONTROLLER_MAX_APPS + 1, shownAppId());
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, extra_app->enter_count);
+
+    // removing an app makes room again
+    app_controller.removeApp(first_app);
+    TEST_ASSERT_TRUE(app_controller.addApp(extra_app));
+    TEST_ASSERT_EQUAL_UINT32(1, extra_app->init_count);
+}
+
+// returns the time of an update with nothing to do, plus getIdleMillis, like an iteration of the main loop
+static double benchmarkUpdate(AppControllerBase &app_controller) {
+    const int rounds = 1000000;
+    run(app_controller, 100);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        app_controller.update();
+        benchmark_sink = app_controller.getIdleMillis();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+}
+
+// benchmark only, the timings are reported and not checked (they depend on the host)
+void test_benchmark() {
+    AppController app_controller(*display);
+    for (uint8_t id = 1; id <= 3; id++) {
+        app_controller.addApp(std::make_shared<StubApp>(id));
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "update: %.1f ns static, %.1f ns runtime (controller size: %u static, %u runtime)",
+        benchmarkUpdate(*controller), benchmarkUpdate(app_controller), (unsigned) sizeof(TestController), (unsigned) sizeof(AppController));
+    TEST_MESSAGE(message);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin);
+    RUN_TEST(test_update_current_app_only);
+    RUN_TEST(test_next_wraps_around);
+    RUN_TEST(test_long_press_goes_to_first_app);
+    RUN_TEST(test_keys_go_to_current_app);
+    RUN_TEST(test_scheduled_frame);
+    RUN_TEST(test_same_output_as_app_controller);
+    RUN_TEST(test_app_controller_limit);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,97 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <string>
+
+#include <TemplateWriter.h>
+
+// collects the output, and checks the chunk sizes
+class StringSink : public TemplateSink {
+public:
+    virtual void write(const char *data, size_t len) override {
+        TEST_ASSERT_TRUE(len > 0 && len <= TEMPLATE_WRITER_BUFFER_SIZE);
+        output.append(data, len);
+        chunks++;
+    }
+
+    std::string output;
+    size_t chunks = 0;
+};
+
+static std::string render(PGM_P tmpl, const char *const *values, size_t num_values) {
+    StringSink sink;
+    TemplateWriter writer(&sink);
+    writer.writeTemplate(tmpl, values, num_values);
+    writer.flush();
+
+    // counting without a sink gives the same length
+    TemplateWriter counter;
+    counter.writeTemplate(tmpl, values, num_values);
+    TEST_ASSERT_EQUAL(sink.output.size(), counter.getLength());
+    TEST_ASSERT_EQUAL(sink.output.size(), writer.getLength());
+
+    return sink.output;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_placeholders() {
+    const char *values[] = { "a", "b", nullptr };
+    TEST_ASSERT_EQUAL_STRING("<b>a</b>, b a", render(PSTR("<b>{0}</b>, {1} {0}"), values, 3).c_str());
+
+    // missing and null values are empty
+    TEST_ASSERT_EQUAL_STRING("[][]", render(PSTR("[{2}][{5}]"), values, 3).c_str());
+    TEST_ASSERT_EQUAL_STRING("[]", render(PSTR("[{0}]"), nullptr, 0).c_str());
+}
+
+void test_no_placeholders() {
+    // braces that don't form a placeholder are written as they are
+    const char *values[] = { "a" };
+    TEST_ASSERT_EQUAL_STRING("{a} {10} {0 { {", render(PSTR("{a} {10} {0 { {"), values, 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("a}", render(PSTR("{0}}"), values, 1).c_str());
+}
+
+void test_escaping() {
+    const char *values[] = { "\"x\" & <y> 'z'" };
+    TEST_ASSERT_EQUAL_STRING("value=\"&quot;x&quot; &amp; &lt;y&gt; &#39;z&#39;\"", render(PSTR("value=\"{0}\""), values, 1).c_str());
+
+    // the template itself is not escaped
+    TEST_ASSERT_EQUAL_STRING("<&>", render(PSTR("<&>"), nullptr, 0).c_str());
+}
+
+void test_chunks() {
+    // more output than fits into the buffer, also with escaped values across the buffer boundary
+    std::string value(1000, '&');
+    const char *values[] = { value.c_str() };
+    StringSink sink;
+    TemplateWriter writer(&sink);
+    writer.writeTemplate(PSTR("x{0}y"), values, 1);
+    writer.writeEscaped("<");
+    writer.flush();
+
+    std::string expected = "x";
+    for (size_t i = 0; i < value.size(); i++) {
+        expected += "&amp;";
+    }
+    expected += "y&lt;";
+    TEST_ASSERT_TRUE(expected == sink.output);
+    TEST_ASSERT_EQUAL(expected.size(), writer.getLength());
+    TEST_ASSERT_EQUAL((expected.size() + TEMPLATE_WRITER_BUFFER_SIZE - 1) / TEMPLATE_WRITER_BUFFER_SIZE, sink.chunks);
+
+    // flushing again doesn't write anything
+    writer.flush();
+    TEST_ASSERT_EQUAL((expected.size() + TEMPLATE_WRITER_BUFFER_SIZE - 1) / TEMPLATE_WRITER_BUFFER_SIZE, sink.chunks);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_placeholders);
+    RUN_TEST(test_no_placeholders);
+    RUN_TEST(test_escaping);
+    RUN_TEST(test_chunks);
+    return UNITY_END();
+}
@@ -0,0 +1,205 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <TimeDiscipline.h>
+
+// reference time at monotonic time 0 (2023-11-14)
+#define EPOCH_MICROS 1700000000000000LL
+
+#define SECOND 1000000LL
+
+static TimeDiscipline *discipline;
+
+// deterministic pseudo-random numbers (LCG), so that failures are reproducible
+static uint32_t random_state;
+
+static int64_t nextNoise(int64_t amplitude) {
+    random_state = random_state * 1664525 + 1013904223;
+    return (int64_t) (random_state >> 8) % (2 * amplitude + 1) - amplitude;
+}
+
+// reference time of a simulated monotonic timer that runs slow by the given frequency error
+static int64_t getRefTime(int64_t mono, int32_t frequency_ppb) {
+    return EPOCH_MICROS + mono + mono * frequency_ppb / 1000000000LL;
+}
+
+// checks that the disciplined time is monotonic and its rate within the slew and frequency limits, in 1 ms steps
+static void assertRateLimited(int64_t mono_from, int64_t mono_to) {
+    const int64_t step = 1000;
+    const int64_t max_deviation = step * (TIME_DISCIPLINE_SLEW_RATE_PPM * 1000LL + TIME_DISCIPLINE_MAX_FREQUENCY_PPB) / 1000000000LL + 1;
+    int64_t last = discipline->getTime(mono_from);
+    for (int64_t mono = mono_from + step; mono <= mono_to; mono += step) {
+        int64_t time = discipline->getTime(mono);
+        TEST_ASSERT_INT64_WITHIN(max_deviation, step, time - last);
+        last = time;
+    }
+}
+
+void setUp() {
+    discipline = new TimeDiscipline();
+    random_state = 1;
+}
+
+void tearDown() {
+    delete discipline;
+}
+
+void test_first_sample_sets_time() {
+    TEST_ASSERT_FALSE(discipline->isSet());
+    discipline->addSample(10 * SECOND, EPOCH_MICROS);
+    TEST_ASSERT_TRUE(discipline->isSet());
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS + SECOND, discipline->getTime(11 * SECOND));
+}
+
+void test_small_offset_is_slewed() {
+    discipline->addSample(0, EPOCH_MICROS);
+    // 50 ms behind, within the spike threshold
+    discipline->addSample(10 * SECOND, EPOCH_MICROS + 10 * SECOND + 50000);
+    TEST_ASSERT_EQUAL_INT64(50000, discipline->getLastOffset());
+    TEST_ASSERT_EQUAL_UINT32(0, discipline->getSteps());
+
+    // slewing 50 ms at 0.5% takes 10 s
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS + 10 * SECOND, discipline->getTime(10 * SECOND));
+    TEST_ASSERT_EQUAL_INT64(25000, discipline->getRemainingSlew(15 * SECOND));
+    TEST_ASSERT_EQUAL_INT64(0, discipline->getRemainingSlew(20 * SECOND));
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS + 30 * SECOND + 50000, discipline->getTime(30 * SECOND));
+    assertRateLimited(9 * SECOND, 21 * SECOND);
+}
+
+void test_spike_is_ignored() {
+    discipline->addSample(0, EPOCH_MICROS);
+    discipline->addSample(10 * SECOND, EPOCH_MICROS + 10 * SECOND + 300000);
+    TEST_ASSERT_EQUAL_UINT32(1, discipline->getSpikes());
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS + 20 * SECOND, discipline->getTime(20 * SECOND));
+
+    // a regular sample after the spike
+    discipline->addSample(20 * SECOND, EPOCH_MICROS + 20 * SECOND);
+    TEST_ASSERT_EQUAL_UINT32(1, discipline->getSpikes());
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS + 30 * SECOND, discipline->getTime(30 * SECOND));
+}
+
+void test_offset_step() {
+    discipline->addSample(0, EPOCH_MICROS);
+
+    // e.g. the reference has been corrected by 2 s, the first sample is taken for a spike, the second one steps
+    discipline->addSample(10 * SECOND, EPOCH_MICROS + 12 * SECOND);
+    TEST_ASSERT_EQUAL_UINT32(1, discipline->getSpikes());
+    TEST_ASSERT_EQUAL_UINT32(0, discipline->getSteps());
+    discipline->addSample(20 * SECOND, EPOCH_MICROS + 22 * SECOND);
+    TEST_ASSERT_EQUAL_UINT32(1, discipline->getSteps());
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS + 22 * SECOND, discipline->getTime(20 * SECOND));
+    TEST_ASSERT_EQUAL_INT64(0, discipline->getRemainingSlew(20 * SECOND));
+
+    // stepping backwards too
+    discipline->addSample(30 * SECOND, EPOCH_MICROS + 29 * SECOND);
+    discipline->addSample(40 * SECOND, EPOCH_MICROS + 39 * SECOND);
+    TEST_ASSERT_EQUAL_UINT32(2, discipline->getSteps());
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS + 39 * SECOND, discipline->getTime(40 * SECOND));
+}
+
+void test_frequency_error_is_estimated() {
+    // the timer runs 40 ppm slow, samples are taken every 15 minutes with 2 ms of noise
+    const int32_t frequency_ppb = 40000;
+    const int64_t interval = 900 * SECOND;
+    int64_t max_offset = 0;
+    for (int i = 0; i < 48; i++) {
+        int64_t mono = i * interval;
+        discipline->addSample(mono, getRefTime(mono, frequency_ppb) + nextNoise(2000));
+        if (i >= 16) {
+            int64_t offset = discipline->getLastOffset();
+            max_offset = offset > max_offset ? offset : (-offset > max_offset ? -offset : max_offset);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, discipline->getSpikes());
+    TEST_ASSERT_EQUAL_UINT32(0, discipline->getSteps());
+    TEST_ASSERT_INT32_WITHIN(3000, frequency_ppb, discipline->getFrequencyPpb());
+
+    // without compensation, the offset would be 36 ms after each interval
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(5000, max_offset);
+
+    // the estimate keeps the clock on time while no samples arrive
+    int64_t mono = 48 * interval + 3600 * SECOND;
+    TEST_ASSERT_INT64_WITHIN(20000, getRefTime(mono, frequency_ppb), discipline->getTime(mono));
+}
+
+void test_frequency_error_is_limited() {
+    // the estimate is clamped, e.g. if the reference is wrong
+    discipline->addSample(0, EPOCH_MICROS);
+    for (int i = 1; i <= 20; i++) {
+        discipline->addSample(i * 100 * SECOND, getRefTime(i * 100 * SECOND, 2000000));
+    }
+    TEST_ASSERT_EQUAL_INT32(TIME_DISCIPLINE_MAX_FREQUENCY_PPB, discipline->getFrequencyPpb());
+}
+
+void test_step_keeps_frequency() {
+    // the timer runs 20 ppm slow, which has been estimated from hourly samples
+    const int32_t frequency_ppb = 20000;
+    const int64_t interval = 3600 * SECOND;
+    for (int i = 0; i < 24; i++) {
+        discipline->addSample(i * interval, getRefTime(i * interval, frequency_ppb));
+    }
+    int32_t estimated_ppb = discipline->getFrequencyPpb();
+    TEST_ASSERT_INT32_WITHIN(1000, frequency_ppb, estimated_ppb);
+
+    // the reference jumps by 1 s (confirmed by the next sample), which would be +139 ppm if taken for a frequency error
+    for (int i = 24; i < 26; i++) {
+        discipline->addSample(i * interval, getRefTime(i * interval, frequency_ppb) + SECOND);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, discipline->getSteps());
+    TEST_ASSERT_EQUAL_INT32(estimated_ppb, discipline->getFrequencyPpb());
+
+    // and the same for offsets large enough to overflow the frequency calculation (e.g. a reference off by years)
+    for (int i = 26; i < 28; i++) {
+        discipline->addSample(i * interval, getRefTime(i * interval, frequency_ppb) + 100000000 * SECOND);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, discipline->getSteps());
+    TEST_ASSERT_EQUAL_INT32(estimated_ppb, discipline->getFrequencyPpb());
+    TEST_ASSERT_EQUAL_INT64(getRefTime(27 * interval, frequency_ppb) + 100000000 * SECOND, discipline->getTime(27 * interval));
+}
+
+void test_before_anchor() {
+    discipline->addSample(1000 * SECOND, EPOCH_MICROS);
+    // 50 ms ahead, so that the slew is negative
+    discipline->addSample(1010 * SECOND, EPOCH_MICROS + 10 * SECOND - 50000);
+    TEST_ASSERT_EQUAL_INT64(-50000, discipline->getRemainingSlew(1010 * SECOND));
+
+    // before the anchor, the time is extrapolated without slewing
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS, discipline->getTime(1000 * SECOND));
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS - 90 * SECOND, discipline->getTime(910 * SECOND));
+    assertRateLimited(1009 * SECOND, 1011 * SECOND);
+
+    // the same for a positive slew
+    discipline->addSample(1020 * SECOND, EPOCH_MICROS + 20 * SECOND + 50000);
+    TEST_ASSERT_EQUAL_INT64(EPOCH_MICROS + 20 * SECOND - 50000 - 90 * SECOND, discipline->getTime(930 * SECOND));
+    assertRateLimited(1019 * SECOND, 1021 * SECOND);
+}
+
+void test_mono_time() {
+    discipline->addSample(0, EPOCH_MICROS);
+    discipline->addSample(10 * SECOND, EPOCH_MICROS + 10 * SECOND - 50000);
+
+    // the first monotonic time at which the time is reached, also with a hint far off and before the anchor
+    const int64_t monos[] = { 10 * SECOND + 1, 12 * SECOND + 345678, 25 * SECOND, 9 * SECOND };
+    for (int64_t mono : monos) {
+        int64_t time = discipline->getTime(mono);
+        int64_t found = discipline->getMonoTime(time, mono + SECOND);
+        TEST_ASSERT_TRUE(discipline->getTime(found) >= time);
+        TEST_ASSERT_TRUE(discipline->getTime(found - 1) < time);
+        TEST_ASSERT_INT64_WITHIN(1, mono, found);
+    }
+    TEST_ASSERT_EQUAL_INT64(5 * SECOND - 50000, discipline->getMonoTime(EPOCH_MICROS + 5 * SECOND - 50000, 11 * SECOND));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_sample_sets_time);
+    RUN_TEST(test_small_offset_is_slewed);
+    RUN_TEST(test_spike_is_ignored);
+    RUN_TEST(test_offset_step);
+    RUN_TEST(test_frequency_error_is_estimated);
+    RUN_TEST(test_frequency_error_is_limited);
+    RUN_TEST(test_step_keeps_frequency);
+    RUN_TEST(test_before_anchor);
+    RUN_TEST(test_mono_time);
+    return UNITY_END();
+}
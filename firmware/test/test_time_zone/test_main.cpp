@@ -0,0 +1,210 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <chrono>
+
+#include <TimeZone.h>
+
+// the host C library (glibc) serves as the reference, the names are chosen so that no zoneinfo file is used instead of the rules
+static const char *const TZS[] = {
+    "",
+    "UTC0",
+    "CET-1CEST,M3.5.0,M10.5.0/3",
+    "EST5EDT,M3.2.0,M11.1.0",
+    // southern hemisphere, DST across the turn of the year
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    // offsets that are not whole hours, quoted names
+    "IST-5:30",
+    "<+0545>-5:45",
+    "<-0330>3:30<-0230>,M3.2.0,M11.1.0",
+    // transition times that are negative or beyond 24 hours
+    "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1",
+    "EET-2EEST,M3.5.4/24,M10.5.5/1",
+    // DST offset below the standard offset
+    "IST-1GMT0,M10.5.0,M3.5.0/1",
+    // Julian days and zero-based days
+    "XST3XDT,J60/2,J300/2",
+    "XST3XDT,59/2,299/2",
+};
+
+// 2020-01-01 to 2041-01-01, including leap years and 2038
+#define START_TIME ((time_t) 1577836800)
+#define END_TIME ((time_t) 2240611200)
+
+// 1971-01-01 to 2100-01-01, for random times
+#define RANDOM_START_TIME ((time_t) 31536000)
+#define RANDOM_END_TIME ((time_t) 4102444800)
+
+static volatile int benchmark_sink;
+
+static void assertLocalTime(TimeZone &zone, time_t time, const char *tz) {
+    tm expected;
+    localtime_r(&time, &expected);
+    tm actual;
+    zone.toLocal(time, actual);
+    bool dst;
+    int32_t offset = zone.getOffset(time, &dst);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%s at %lld", tz, (long long) time);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_gmtoff, offset, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_isdst > 0, dst, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_year, actual.tm_year, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_mon, actual.tm_mon, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_mday, actual.tm_mday, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_hour, actual.tm_hour, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_min, actual.tm_min, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_sec, actual.tm_sec, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_wday, actual.tm_wday, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_yday, actual.tm_yday, message);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected.tm_isdst, actual.tm_isdst, message);
+}
+
+void setUp() {
+}
+
+void tearDown() {
+    unsetenv("TZ");
+    tzset();
+}
+
+void test_matches_localtime_at_transitions() {
+    for (const char *tz : TZS) {
+        setenv("TZ", tz, 1);
+        tzset();
+        TimeZone zone;
+        TEST_ASSERT_TRUE(zone.set(tz));
+
+        uint32_t transitions = 0;
+        for (time_t time = zone.getNextTransition(START_TIME); time < END_TIME; time = zone.getNextTransition(time)) {
+            // the offset changes exactly at the transition
+            tm before, at;
+            time_t before_time = time - 1;
+            localtime_r(&before_time, &before);
+            localtime_r(&time, &at);
+            char message[128];
+            snprintf(message, sizeof(message), "%s at %lld", tz, (long long) time);
+            TEST_ASSERT_TRUE_MESSAGE(before.tm_gmtoff != at.tm_gmtoff, message);
+
+            assertLocalTime(zone, time - 1, tz);
+            assertLocalTime(zone, time, tz);
+            assertLocalTime(zone, time + 1, tz);
+            transitions++;
+        }
+
+        // two transitions per year with DST, none without
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(strchr(tz, ',') ? 42 : 0, transitions, tz);
+    }
+}
+
+void test_matches_localtime_between_transitions() {
+    // a step that is not a divisor of a day, so that all times of day are covered over the years
+    for (const char *tz : TZS) {
+        setenv("TZ", tz, 1);
+        tzset();
+        TimeZone zone;
+        TEST_ASSERT_TRUE(zone.set(tz));
+        for (time_t time = START_TIME; time < END_TIME; time += 3607) {
+            assertLocalTime(zone, time, tz);
+        }
+    }
+}
+
+void test_matches_localtime_at_random_times() {
+    // deterministic pseudo-random numbers (LCG), so that failures are reproducible
+    uint32_t random_state = 1;
+    for (const char *tz : TZS) {
+        setenv("TZ", tz, 1);
+        tzset();
+        TimeZone zone;
+        TEST_ASSERT_TRUE(zone.set(tz));
+        for (int i = 0; i < 20000; i++) {
+            random_state = random_state * 1664525 + 1013904223;
+            uint64_t random = random_state;
+            random_state = random_state * 1664525 + 1013904223;
+            random = random << 32 | random_state;
+            assertLocalTime(zone, RANDOM_START_TIME + (time_t) (random % (RANDOM_END_TIME - RANDOM_START_TIME)), tz);
+        }
+    }
+}
+
+void test_matches_localtime_backwards() {
+    // the cache must also work if the time moves backwards
+    const char *tz = "CET-1CEST,M3.5.0,M10.5.0/3";
+    setenv("TZ", tz, 1);
+    tzset();
+    TimeZone zone;
+    TEST_ASSERT_TRUE(zone.set(tz));
+    for (time_t time = END_TIME; time > START_TIME; time -= 86413) {
+        assertLocalTime(zone, time, tz);
+    }
+}
+
+void test_default_rules() {
+    // not compared with glibc, which takes the default rules from the zoneinfo file posixrules if it exists (newlib doesn't)
+    TimeZone zone;
+    TEST_ASSERT_TRUE(zone.set("XST5XDT"));
+    TimeZone explicit_zone;
+    TEST_ASSERT_TRUE(explicit_zone.set("XST5XDT,M3.2.0/2,M11.1.0/2"));
+    for (time_t time = START_TIME; time < END_TIME; time += 3607) {
+        bool dst, explicit_dst;
+        TEST_ASSERT_EQUAL_INT32(explicit_zone.getOffset(time, &explicit_dst), zone.getOffset(time, &dst));
+        TEST_ASSERT_EQUAL(explicit_dst, dst);
+    }
+    TEST_ASSERT_EQUAL_INT64(explicit_zone.getNextTransition(START_TIME), zone.getNextTransition(START_TIME));
+}
+
+void test_invalid_is_utc() {
+    TimeZone zone;
+    TEST_ASSERT_FALSE(zone.set("CET-1CEST,M3.5"));
+    TEST_ASSERT_EQUAL_INT32(0, zone.getOffset(START_TIME));
+    TEST_ASSERT_FALSE(zone.set("X1"));
+    TEST_ASSERT_EQUAL_INT32(0, zone.getOffset(START_TIME));
+}
+
+// benchmark only, the timings are reported and not checked (they depend on the host)
+void test_benchmark() {
+    // one conversion per second, like ClockApp does
+    const char *tz = "CET-1CEST,M3.5.0,M10.5.0/3";
+    const int seconds = 2000000;
+    setenv("TZ", tz, 1);
+    tzset();
+    TimeZone zone;
+    TEST_ASSERT_TRUE(zone.set(tz));
+
+    auto start = std::chrono::steady_clock::now();
+    for (time_t time = START_TIME; time < START_TIME + seconds; time++) {
+        tm local;
+        localtime_r(&time, &local);
+        benchmark_sink = local.tm_sec;
+    }
+    auto reference_end = std::chrono::steady_clock::now();
+    for (time_t time = START_TIME; time < START_TIME + seconds; time++) {
+        tm local;
+        zone.toLocal(time, local);
+        benchmark_sink = local.tm_sec;
+    }
+    auto zone_end = std::chrono::steady_clock::now();
+
+    char message[96];
+    snprintf(message, sizeof(message), "toLocal: %.1f ns (localtime_r: %.1f ns)",
+        std::chrono::duration<double, std::nano>(zone_end - reference_end).count() / seconds,
+        std::chrono::duration<double, std::nano>(reference_end - start).count() / seconds);
+    TEST_MESSAGE(message);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_localtime_at_transitions);
+    RUN_TEST(test_matches_localtime_between_transitions);
+    RUN_TEST(test_matches_localtime_at_random_times);
+    RUN_TEST(test_matches_localtime_backwards);
+    RUN_TEST(test_default_rules);
+    RUN_TEST(test_invalid_is_utc);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}